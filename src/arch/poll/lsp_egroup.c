@@ -0,0 +1,73 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_egroup.h"
+#include "lsp_memory.h"
+#include "lsp_log.h"
+
+#if !(LSP_CORE_POLL)
+#error "This source is for LSP_CORE_POLL builds only"
+#endif
+
+/** single threaded event group, bits are only read back, nothing waits for them */
+
+static const char *tag = "poll/lsp_egroup";
+
+int lsp_egroup_init(lsp_egroup_handle_t handle)
+{
+    handle->event_bits = 0;
+    return LSP_ERR_NONE;
+}
+
+lsp_egroup_handle_t lsp_egroup_create()
+{
+    lsp_egroup_handle_t handle = lsp_malloc(sizeof(struct lsp_egroup_handle_s));
+
+    if (handle == NULL)
+    {
+        lsp_verb(tag, "%s: could not allocate event group\n", __FUNCTION__);
+        return NULL;
+    }
+    handle->event_bits = 0;
+    return handle;
+}
+
+void lsp_egroup_destroy(lsp_egroup_handle_t handle)
+{
+    lsp_free(handle);
+}
+
+lsp_egroup_bits_t lsp_egroup_wait(lsp_egroup_handle_t handle, lsp_egroup_bits_t bits, int clearOnExit, int waitAll, uint32_t timeout)
+{
+    lsp_egroup_bits_t ebits = handle->event_bits;
+
+    // the bits are whatever lsp_core_poll has set so far, waiting longer would never see more
+    if (clearOnExit)
+        handle->event_bits = 0;
+    else
+        handle->event_bits &= ~bits;
+    return ebits;
+}
+
+lsp_egroup_bits_t lsp_egroup_set(lsp_egroup_handle_t handle, lsp_egroup_bits_t bits)
+{
+    handle->event_bits |= bits;
+    return handle->event_bits;
+}
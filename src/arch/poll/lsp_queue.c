@@ -0,0 +1,161 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_queue.h"
+#include "lsp_memory.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+#if !(LSP_CORE_POLL)
+#error "This source is for LSP_CORE_POLL builds only"
+#endif
+
+static const char *tag = "poll/lsp_queue";
+
+/** single threaded ring, struct and buffer are one contiguous chunk. 
+ * Nothing waits, timeouts only select the error returned on a full or empty queue */
+typedef struct _lsp_queue_handle
+{
+    int length, head, tail;
+    int queue_size;
+    size_t itemsize;
+    uint8_t *data;
+} _lsp_queue_handle_t;
+
+#define ENTRY_FIND(hdl, index) ((hdl)->data + (size_t)(index) * (hdl)->itemsize)
+
+lsp_queue_handle_t lsp_queue_create(int length, size_t itemsize)
+{
+    _lsp_queue_handle_t *hdl;
+
+    hdl = lsp_malloc(ALIGNED_SIZEOF(_lsp_queue_handle_t) + length * itemsize);
+    if (hdl == NULL)
+    {
+        lsp_verb(tag, "%s: could not allocate queue of %d\n", __FUNCTION__, length);
+        return NULL;
+    }
+
+    hdl->head = 0;
+    hdl->tail = 0;
+    hdl->length = 0;
+    hdl->queue_size = length;
+    hdl->itemsize = itemsize;
+    hdl->data = (uint8_t *)hdl + ALIGNED_SIZEOF(_lsp_queue_handle_t);
+    return (lsp_queue_handle_t)hdl;
+}
+
+int lsp_queue_destroy(lsp_queue_handle_t handle)
+{
+    lsp_free(handle);
+    return LSP_ERR_NONE;
+}
+
+int lsp_queue_push(lsp_queue_handle_t handle, const void *const data, const uint32_t timeout)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    if (hdl->length >= hdl->queue_size)
+        return timeout > 0 ? LSP_ERR_TIMEOUT : LSP_ERR_QUEUE_FULL;
+
+    memcpy(ENTRY_FIND(hdl, hdl->tail), data, hdl->itemsize);
+    hdl->tail = (hdl->tail + 1) % hdl->queue_size;
+    hdl->length++;
+    return LSP_ERR_NONE;
+}
+
+int lsp_queue_pop(lsp_queue_handle_t handle, void *data, const uint32_t timeout)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    if (hdl->length <= 0)
+        return timeout > 0 ? LSP_ERR_TIMEOUT : LSP_ERR_QUEUE_EMPTY;
+
+    memcpy(data, ENTRY_FIND(hdl, hdl->head), hdl->itemsize);
+    hdl->head = (hdl->head + 1) % hdl->queue_size;
+    hdl->length--;
+    return LSP_ERR_NONE;
+}
+
+int lsp_queue_push_burst(lsp_queue_handle_t handle, const void *const data, int n, const uint32_t timeout)
+{
+    int count = 0;
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    while (count < n && hdl->length < hdl->queue_size)
+    {
+        memcpy(ENTRY_FIND(hdl, hdl->tail), (const uint8_t *)data + count * hdl->itemsize, hdl->itemsize);
+        hdl->tail = (hdl->tail + 1) % hdl->queue_size;
+        hdl->length++;
+        count++;
+    }
+    return count;
+}
+
+int lsp_queue_pop_burst(lsp_queue_handle_t handle, void *data, int n, const uint32_t timeout)
+{
+    int count = 0;
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    while (count < n && hdl->length > 0)
+    {
+        memcpy((uint8_t *)data + count * hdl->itemsize, ENTRY_FIND(hdl, hdl->head), hdl->itemsize);
+        hdl->head = (hdl->head + 1) % hdl->queue_size;
+        hdl->length--;
+        count++;
+    }
+    return count;
+}
+
+int lsp_queue_set_spin(lsp_queue_handle_t handle, uint32_t spin_us)
+{
+    // nothing to busy poll for, pops never wait
+    return spin_us > LSP_SPIN_MAX_US ? LSP_ERR_INVALID : LSP_ERR_NONE;
+}
+
+int lsp_queue_getspin(lsp_queue_handle_t handle, uint32_t *spin_us, lsp_spin_stats_t *stats)
+{
+    if (spin_us)
+        *spin_us = 0;
+    if (stats)
+        memset(stats, 0, sizeof(*stats));
+    return LSP_ERR_NONE;
+}
+
+int lsp_queue_length(lsp_queue_handle_t handle)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+    return hdl->queue_size;
+}
+
+int lsp_queue_itemsize(lsp_queue_handle_t handle)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+    return hdl->itemsize;
+}
+
+int lsp_queue_clear(lsp_queue_handle_t handle)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+    hdl->head = 0;
+    hdl->tail = 0;
+    hdl->length = 0;
+    return LSP_ERR_NONE;
+}
@@ -119,6 +119,11 @@ notimeout:
 timeout:
     ts.tv_sec += timeout / 1000;
     ts.tv_nsec += (timeout % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+    }
     rc = pthread_cond_timedwait(cond, mutex, &ts);
 end:
 
@@ -153,7 +158,8 @@ lsp_egroup_bits_t lsp_egroup_wait(lsp_egroup_handle_t handle, lsp_egroup_bits_t
         }
         else if (timeout > 0)
         {
-            while (remaining_timeout > 0)
+            // bits set before waiting must not sleep through the timeout
+            while (remaining_timeout > 0 && (handle->event_bits & bits) != bits)
             {
                 currrent_time = lsp_gettime_ms();
                 remaining_timeout = (max_time > currrent_time ? max_time - currrent_time : 0);
@@ -190,7 +196,7 @@ lsp_egroup_bits_t lsp_egroup_wait(lsp_egroup_handle_t handle, lsp_egroup_bits_t
         }
         else if (timeout > 0)
         {
-            while (remaining_timeout > 0)
+            while (remaining_timeout > 0 && !(handle->event_bits & bits))
             {
                 currrent_time = lsp_gettime_ms();
                 remaining_timeout = (max_time > currrent_time ? max_time - currrent_time : 0);
@@ -238,9 +244,12 @@ lsp_egroup_bits_t lsp_egroup_set(lsp_egroup_handle_t handle, lsp_egroup_bits_t b
     }
 
     handle->event_bits |= bits;
+    bits = handle->event_bits;
     pthread_cond_broadcast(&handle->cond);
 mutex_err:
     lsp_mutex_unlock(&handle->mutex);
+    // waiter may destroy the group as soon as the mutex is released
+    return bits;
 err:
-    return handle->event_bits;
+    return 0;
 }
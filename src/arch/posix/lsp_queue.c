@@ -21,6 +21,8 @@
 #include "lsp_memory.h"
 #include "lsp_mutex.h"
 #include "lsp_log.h"
+#include "lsp_time.h"
+#include "lsp_spin.h"
 
 #include "signal.h"
 #include "string.h"
@@ -41,6 +43,8 @@ typedef struct _lsp_queue_handle
 {
     sig_atomic_t length, head, tail, waiting_full, waiting_empty;
     size_t queue_size, itemsize;
+    uint32_t filled_us; /** time the queue last became non empty */
+    lsp_spin_t spin;
     lsp_mutex_t mutex;
     pthread_cond_t cond_full, cond_empty;
     uint8_t *data;
@@ -69,6 +73,11 @@ notimeout:
 timeout:
     ts.tv_sec += timeout / 1000;
     ts.tv_nsec += (timeout % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+    }
     rc = pthread_cond_timedwait(cond, mutex, &ts);
 end:
 
@@ -179,12 +188,14 @@ int lsp_queue_push(lsp_queue_handle_t handle, const void *const data, const uint
         }
     }
 
+    if (hdl->length == 0)
+        hdl->filled_us = lsp_gettime_us();
     entryPtr = ENTRY_FIND(hdl->data, hdl->tail, hdl->itemsize);
     memcpy(entryPtr, data, hdl->itemsize);
     lsp_verb(tag, "%s: idx: %d @ %p\n", __FUNCTION__, hdl->tail, entryPtr);
 
     hdl->tail = ++hdl->tail % hdl->queue_size;
-    hdl->length++;
+    __atomic_store_n(&hdl->length, hdl->length + 1, __ATOMIC_RELAXED);
     pthread_cond_signal(&hdl->cond_empty);
     rc = LSP_ERR_NONE;
 mutex_err:
@@ -193,12 +204,62 @@ err:
     return rc;
 }
 
+int lsp_queue_push_burst(lsp_queue_handle_t handle, const void *const data, int n, const uint32_t timeout)
+{
+    int rc, count = 0;
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    // start of protected access
+    rc = lsp_mutex_lock(&hdl->mutex, timeout);
+    if (rc != LSP_ERR_NONE)
+        goto err;
+
+    if (hdl->length >= hdl->queue_size && timeout > 0)
+    {
+        hdl->waiting_full++;
+        queue_wait_internal(&hdl->cond_full, &hdl->mutex, timeout);
+        hdl->waiting_full--;
+    }
+
+    if (n > 0 && hdl->length == 0)
+        hdl->filled_us = lsp_gettime_us();
+    while (count < n && hdl->length < hdl->queue_size)
+    {
+        memcpy(ENTRY_FIND(hdl->data, hdl->tail, hdl->itemsize),
+               (const uint8_t *)data + count * hdl->itemsize, hdl->itemsize);
+        hdl->tail = (hdl->tail + 1) % hdl->queue_size;
+        __atomic_store_n(&hdl->length, hdl->length + 1, __ATOMIC_RELAXED);
+        count++;
+    }
+
+    if (count > 0)
+        pthread_cond_signal(&hdl->cond_empty);
+    lsp_mutex_unlock(&hdl->mutex);
+err:
+    return count;
+}
+
+static int queue_ready(void *arg)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)arg;
+    return __atomic_load_n(&hdl->length, __ATOMIC_RELAXED) > 0;
+}
+
 int lsp_queue_pop(lsp_queue_handle_t handle, void *data, const uint32_t timeout)
 {
-    int rc;
+    int rc, waited = 0, spun = 0;
+    uint32_t now, start = 0;
     void *entryPtr;
     _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
 
+    // busy poll without the lock first, the spin budget is read atomically and the lock below orders the entry and filled_us
+    if (timeout > 0 && !queue_ready(hdl) && lsp_spin_budget(&hdl->spin))
+    {
+        waited = 1;
+        start = lsp_gettime_us();
+        spun = lsp_spin_wait(&hdl->spin, queue_ready, hdl);
+    }
+
     // start of protected access
     rc = lsp_mutex_lock(&hdl->mutex, timeout);
     if (rc != LSP_ERR_NONE)
@@ -208,6 +269,10 @@ int lsp_queue_pop(lsp_queue_handle_t handle, void *data, const uint32_t timeout)
     {
         if (timeout > 0)
         {
+            if (!waited)
+                start = lsp_gettime_us();
+            waited = 1;
+            spun = 0;
             hdl->waiting_empty++;
             rc = queue_wait_internal(&hdl->cond_empty, &hdl->mutex, timeout);
             hdl->waiting_empty--;
@@ -229,8 +294,13 @@ int lsp_queue_pop(lsp_queue_handle_t handle, void *data, const uint32_t timeout)
     lsp_verb(tag, "%s:  idx: %d @ %p\n", __FUNCTION__, hdl->head, entryPtr);
 
     hdl->head = ++hdl->head % hdl->queue_size;
-    hdl->length--;
+    __atomic_store_n(&hdl->length, hdl->length - 1, __ATOMIC_RELAXED);
     pthread_cond_signal(&hdl->cond_full);
+    if (waited)
+    {
+        now = lsp_gettime_us();
+        lsp_spin_record(&hdl->spin, now - start, now - hdl->filled_us, spun);
+    }
     rc = LSP_ERR_NONE;
 mutex_err:
     lsp_mutex_unlock(&hdl->mutex);
@@ -238,6 +308,62 @@ err:
     return rc;
 }
 
+int lsp_queue_pop_burst(lsp_queue_handle_t handle, void *data, int n, const uint32_t timeout)
+{
+    int rc, count = 0;
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+
+    // start of protected access
+    rc = lsp_mutex_lock(&hdl->mutex, timeout);
+    if (rc != LSP_ERR_NONE)
+        goto err;
+
+    if (hdl->length <= 0 && timeout > 0)
+    {
+        hdl->waiting_empty++;
+        queue_wait_internal(&hdl->cond_empty, &hdl->mutex, timeout);
+        hdl->waiting_empty--;
+    }
+
+    while (count < n && hdl->length > 0)
+    {
+        memcpy((uint8_t *)data + count * hdl->itemsize,
+               ENTRY_FIND(hdl->data, hdl->head, hdl->itemsize), hdl->itemsize);
+        hdl->head = (hdl->head + 1) % hdl->queue_size;
+        __atomic_store_n(&hdl->length, hdl->length - 1, __ATOMIC_RELAXED);
+        count++;
+    }
+
+    if (count > 0)
+        pthread_cond_broadcast(&hdl->cond_full);
+    lsp_mutex_unlock(&hdl->mutex);
+err:
+    return count;
+}
+
+int lsp_queue_set_spin(lsp_queue_handle_t handle, uint32_t spin_us)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+    if (spin_us > LSP_SPIN_MAX_US)
+        return LSP_ERR_INVALID;
+    lsp_mutex_lock(&hdl->mutex, LSP_TIMEOUT_MAX);
+    lsp_spin_init(&hdl->spin, spin_us);
+    lsp_mutex_unlock(&hdl->mutex);
+    return LSP_ERR_NONE;
+}
+
+int lsp_queue_getspin(lsp_queue_handle_t handle, uint32_t *spin_us, lsp_spin_stats_t *stats)
+{
+    _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
+    lsp_mutex_lock(&hdl->mutex, LSP_TIMEOUT_MAX);
+    if (spin_us)
+        *spin_us = hdl->spin.max_us;
+    if (stats)
+        *stats = hdl->spin.stats;
+    lsp_mutex_unlock(&hdl->mutex);
+    return LSP_ERR_NONE;
+}
+
 int lsp_queue_length(lsp_queue_handle_t handle)
 {
     _lsp_queue_handle_t *hdl = (_lsp_queue_handle_t *)handle;
@@ -258,7 +384,7 @@ int lsp_queue_clear(lsp_queue_handle_t handle)
     lsp_mutex_lock(&hdl->mutex, LSP_TIMEOUT_MAX);
     hdl->head = 0;
     hdl->tail = 0;
-    hdl->length = 0;
+    __atomic_store_n(&hdl->length, 0, __ATOMIC_RELAXED);
     lsp_mutex_unlock(&hdl->mutex);
     return LSP_ERR_NONE;
 }
\ No newline at end of file
@@ -17,13 +17,59 @@
  *      Cedric Velandres, <ccvelandres@gmail.com>
  */
 
+#define _GNU_SOURCE
 #include "lsp_thread.h"
 #include "lsp_log.h"
 
 #include "string.h"
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
+
+/** linux limits thread names to 15 characters */
+#define THREAD_NAME_LEN 16
 
 static const char *tag = "lsp_thread";
 
+/** maps lsp priorities onto the lower half of the real time range, the upper half is left to irq threads */
+static int thread_sched_param(int policy, unsigned int priority, struct sched_param *param)
+{
+    int min = sched_get_priority_min(policy), max = sched_get_priority_max(policy);
+
+    if (min < 0 || max < 0)
+        return -1;
+    if (priority > LSP_DEFAULT_THREAD_PRIORITY_MAX)
+        priority = LSP_DEFAULT_THREAD_PRIORITY_MAX;
+    param->sched_priority = min + (int)priority * ((max - min) / 2) / LSP_DEFAULT_THREAD_PRIORITY_MAX;
+    return 0;
+}
+
+static int thread_attr_init(pthread_attr_t *attr, unsigned int stack_size, unsigned int priority)
+{
+    int policy = LSP_DEFAULT_THREAD_SCHED == 1 ? SCHED_FIFO : SCHED_RR;
+    struct sched_param param;
+
+    if (pthread_attr_init(attr))
+        return -1;
+
+    if (stack_size)
+    {
+        if (stack_size < PTHREAD_STACK_MIN)
+            stack_size = PTHREAD_STACK_MIN;
+        if (pthread_attr_setstacksize(attr, stack_size))
+            lsp_warn(tag, "%s: could not set stack size %u\n", __FUNCTION__, stack_size);
+    }
+
+    if (LSP_DEFAULT_THREAD_SCHED && thread_sched_param(policy, priority, &param) == 0)
+    {
+        pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(attr, policy);
+        pthread_attr_setschedparam(attr, &param);
+    }
+    return 0;
+}
+
 int lsp_thread_create(lsp_thread_func_t func,
                       const char *name,
                       unsigned int stack_size,
@@ -31,13 +77,103 @@ int lsp_thread_create(lsp_thread_func_t func,
                       unsigned int priority,
                       lsp_thread_handle_t *handle)
 {
-    // create thread with default attr
-    int rc = pthread_create(handle, NULL, func, parameter);
+    pthread_attr_t attr;
+    char tname[THREAD_NAME_LEN];
+    int rc;
+
+    if (thread_attr_init(&attr, stack_size, priority))
+    {
+        lsp_verb(tag, "%s: could not init pthread attr\n", __FUNCTION__);
+        return LSP_ERR;
+    }
+
+    rc = pthread_create(handle, &attr, func, parameter);
+    if (rc == EPERM && LSP_DEFAULT_THREAD_SCHED)
+    {
+        // real time policies need privileges, keep the thread running with time sharing
+        lsp_warn(tag, "%s: no permission for real time scheduling of %s\n", __FUNCTION__, name ? name : "thread");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(handle, &attr, func, parameter);
+    }
+    pthread_attr_destroy(&attr);
     if (rc)
     {
         lsp_verb(tag, "%s: could not create pthread %d:%s\n", __FUNCTION__, rc, strerror(rc));
         return LSP_ERR;
     }
-    else
-        return LSP_ERR_NONE;
-}
\ No newline at end of file
+
+    if (name != NULL)
+    {
+        strncpy(tname, name, sizeof(tname) - 1);
+        tname[sizeof(tname) - 1] = '\0';
+        if ((rc = pthread_setname_np(*handle, tname)) != 0)
+            lsp_verb(tag, "%s: could not name pthread %s %d:%s\n", __FUNCTION__, tname, rc, strerror(rc));
+    }
+    return LSP_ERR_NONE;
+}
+
+int lsp_thread_setaffinity(lsp_thread_handle_t handle, lsp_cpumask_t cpus)
+{
+    cpu_set_t set;
+    int rc;
+
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (cpus == 0 || (cpu < 64 && (cpus & ((lsp_cpumask_t)1 << cpu))))
+            CPU_SET(cpu, &set);
+    }
+
+    rc = pthread_setaffinity_np(handle, sizeof(set), &set);
+    if (rc)
+    {
+        lsp_verb(tag, "%s: could not set affinity %d:%s\n", __FUNCTION__, rc, strerror(rc));
+        return LSP_ERR_INVALID;
+    }
+    return LSP_ERR_NONE;
+}
+
+int lsp_thread_join(lsp_thread_handle_t handle)
+{
+    int rc = pthread_join(handle, NULL);
+    if (rc)
+    {
+        lsp_verb(tag, "%s: could not join pthread %d:%s\n", __FUNCTION__, rc, strerror(rc));
+        return LSP_ERR;
+    }
+    return LSP_ERR_NONE;
+}
+
+int lsp_thread_key_create(lsp_thread_key_t *key, void (*destructor)(void *value))
+{
+    int rc = pthread_key_create(key, destructor);
+    if (rc)
+    {
+        lsp_verb(tag, "%s: could not create key %d:%s\n", __FUNCTION__, rc, strerror(rc));
+        return LSP_ERR;
+    }
+    return LSP_ERR_NONE;
+}
+
+void lsp_thread_key_delete(lsp_thread_key_t key)
+{
+    pthread_key_delete(key);
+}
+
+int lsp_thread_key_set(lsp_thread_key_t key, void *value)
+{
+    int rc = pthread_setspecific(key, value);
+    if (rc)
+    {
+        lsp_verb(tag, "%s: could not set key %d:%s\n", __FUNCTION__, rc, strerror(rc));
+        return LSP_ERR;
+    }
+    return LSP_ERR_NONE;
+}
+
+void lsp_thread_sleep(uint32_t ms)
+{
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
@@ -60,7 +60,16 @@ uint32_t lsp_gettime_ms()
     if (clock_gettime(CLOCK_MONOTONIC, &ts))
         return 0;
 
-    return (((uint32_t)(ts.tv_sec)) * 1000) + (((uint32_t)(ts.tv_nsec)) * 1000000);
+    return (((uint32_t)(ts.tv_sec)) * 1000) + (((uint32_t)(ts.tv_nsec)) / 1000000);
+}
+
+uint32_t lsp_gettime_us()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts))
+        return 0;
+
+    return (((uint32_t)(ts.tv_sec)) * 1000000) + (((uint32_t)(ts.tv_nsec)) / 1000);
 }
 
 uint32_t lsp_gettime_s()
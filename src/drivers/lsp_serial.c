@@ -0,0 +1,378 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_serial.h"
+#include "lsp_buffer.h"
+#include "lsp_thread.h"
+#include "lsp_log.h"
+
+#include "string.h"
+#include "errno.h"
+#include "unistd.h"
+#include <poll.h>
+#include <termios.h>
+
+static const char *tag = "lsp_serial";
+
+/** largest lsp packet */
+#define SERIAL_MTU (sizeof(lsp_packet_t) + LSP_PACKET_PLEN_MAX)
+/** COBS adds one code byte every 254 bytes plus the leading one */
+#define COBS_MAX(len) ((len) + (len) / 254 + 1)
+/** largest encoded frame, without the delimiter */
+#define SERIAL_FRAME_MAX COBS_MAX(SERIAL_MTU)
+/** bytes read from the tty at once */
+#define SERIAL_RX_CHUNK 4096
+
+typedef struct serial_priv_s
+{
+    int fd;                                                      /** tty file descriptor */
+    int wakefd[2];                                               /** pipe to wake rx task on close */
+    volatile int running;                                        /** cleared on close to stop rx task */
+    lsp_thread_handle_t rx_thread;                               /** rx task handle */
+    size_t rxlen;                                                /** length of partial frame in rxframe */
+    int discard;                                                 /** skip bytes until next delimiter */
+    uint8_t rxframe[SERIAL_FRAME_MAX];                           /** partial frame spanning reads */
+    uint8_t txbuf[LSP_DEFAULT_IF_TX_BURST * (SERIAL_FRAME_MAX + 1)]; /** encoded frames of a burst */
+} serial_priv_t;
+
+/** encodes len bytes of src into dst, returns encoded length. Zero runs are found with memchr */
+static size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    const uint8_t *end = src + len;
+    const uint8_t *zero;
+    size_t avail, run, out = 0;
+
+    for (;;)
+    {
+        avail = end - src;
+        zero = memchr(src, 0, avail < 254 ? avail : 254);
+        run = zero != NULL ? (size_t)(zero - src) : (avail < 254 ? avail : 254);
+
+        dst[out++] = run + 1;
+        memcpy(dst + out, src, run);
+        out += run;
+        src += run;
+
+        // zero is implied by the block code, a block always follows it
+        if (zero != NULL)
+            src++;
+        else if (run < 254 || src == end)
+            break;
+    }
+    return out;
+}
+
+/** decodes a frame without delimiter into dst, returns decoded length or -1 on framing error */
+static int cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    size_t run, i = 0, out = 0;
+    uint8_t code;
+
+    while (i < len)
+    {
+        code = src[i++];
+        run = code - 1;
+        if (code == 0 || i + run > len || out + run > cap)
+            return -1;
+
+        memcpy(dst + out, src + i, run);
+        out += run;
+        i += run;
+
+        if (code != 0xFF && i < len)
+        {
+            if (out >= cap)
+                return -1;
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+/** writes all of data, returns bytes written */
+static size_t serial_write(int fd, const uint8_t *data, size_t len)
+{
+    ssize_t rc;
+    size_t written = 0;
+
+    while (written < len)
+    {
+        rc = write(fd, data + written, len - written);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        written += rc;
+    }
+    return written;
+}
+
+/** decodes a complete frame into a new buffer, NULL on framing error or no memory */
+static lsp_buffer_t *serial_frame(lsp_interface_t *iface, const uint8_t *frame, size_t len)
+{
+    lsp_buffer_t *buff;
+    int n;
+
+    // decoded data is always shorter than the encoded frame
+    buff = lsp_buffer_alloc(iface, len);
+    if (buff == NULL)
+    {
+        LSP_IF_STATS_INC(iface, dropped);
+        return NULL;
+    }
+
+    n = cobs_decode(frame, len, buff->data, len);
+    if (n < 0)
+    {
+        lsp_verb(tag, "%s: %s framing error\n", __FUNCTION__, iface->ifname);
+        LSP_IF_STATS_INC(iface, rx_error);
+        lsp_buffer_free(buff);
+        return NULL;
+    }
+    lsp_buffer_put(buff, n);
+    return buff;
+}
+
+static lsp_thread_return_t serial_rx_task(void *arg)
+{
+    lsp_interface_t *iface = arg;
+    serial_priv_t *priv = lsp_interface_getdata(iface);
+    struct pollfd pfd[2] = {{.fd = priv->fd, .events = POLLIN}, {.fd = priv->wakefd[0], .events = POLLIN}};
+    lsp_buffer_t *batch[LSP_DEFAULT_IF_RX_BURST];
+    uint8_t chunk[SERIAL_RX_CHUNK];
+    const uint8_t *p, *end, *delim, *frame;
+    size_t seglen, framelen;
+    ssize_t n;
+    int count;
+
+    while (priv->running)
+    {
+        if (poll(pfd, 2, -1) < 0 || !priv->running)
+            continue;
+        if (pfd[0].revents & (POLLERR | POLLHUP))
+        {
+            // descriptors stay open until serial_close, which still writes to wakefd
+            lsp_err(tag, "%s: %s tty closed\n", __FUNCTION__, iface->ifname);
+            break;
+        }
+        if (!(pfd[0].revents & POLLIN))
+            continue;
+
+        n = read(priv->fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            continue;
+
+        count = 0;
+        p = chunk;
+        end = chunk + n;
+        while (p < end)
+        {
+            // frames are split on delimiters only, decoding works on whole frames
+            delim = memchr(p, 0, end - p);
+            seglen = (delim != NULL ? delim : end) - p;
+
+            if (priv->discard || priv->rxlen + seglen > SERIAL_FRAME_MAX)
+            {
+                if (!priv->discard)
+                {
+                    lsp_verb(tag, "%s: %s oversized frame\n", __FUNCTION__, iface->ifname);
+                    LSP_IF_STATS_INC(iface, rx_error);
+                }
+                priv->rxlen = 0;
+                priv->discard = (delim == NULL);
+                p += seglen + (delim != NULL);
+                continue;
+            }
+
+            if (delim != NULL && priv->rxlen == 0)
+            {
+                // whole frame is in this chunk, decode in place
+                frame = p;
+                framelen = seglen;
+            }
+            else
+            {
+                memcpy(priv->rxframe + priv->rxlen, p, seglen);
+                priv->rxlen += seglen;
+                frame = priv->rxframe;
+                framelen = priv->rxlen;
+            }
+
+            if (delim == NULL)
+                break;
+            p = delim + 1;
+            priv->rxlen = 0;
+
+            // back to back delimiters are used for resync
+            if (framelen == 0)
+                continue;
+
+            batch[count] = serial_frame(iface, frame, framelen);
+            if (batch[count] != NULL && ++count == LSP_DEFAULT_IF_RX_BURST)
+            {
+                lsp_interface_rx_burst(iface, batch, count);
+                count = 0;
+            }
+        }
+
+        if (count > 0)
+            lsp_interface_rx_burst(iface, batch, count);
+    }
+
+    return (lsp_thread_return_t)0;
+}
+
+static int serial_open(lsp_interface_t *iface)
+{
+    int rc;
+    serial_priv_t *priv = lsp_interface_getdata(iface);
+
+    priv->running = 1;
+    rc = lsp_thread_create(serial_rx_task, iface->ifname, LSP_DEFAULT_CORE_STACK_SIZE,
+                           iface, LSP_DEFAULT_CORE_PRIORITY, &priv->rx_thread);
+    if (rc != LSP_ERR_NONE)
+    {
+        lsp_err(tag, "%s: could not create rx task for %s\n", __FUNCTION__, iface->ifname);
+        priv->running = 0;
+    }
+    return rc;
+}
+
+static int serial_close(lsp_interface_t *iface)
+{
+    serial_priv_t *priv = lsp_interface_getdata(iface);
+    uint8_t wake = 0;
+    int rc;
+
+    // rx task may have stopped on hangup already, the pipe is still open either way
+    priv->running = 0;
+    if (write(priv->wakefd[1], &wake, 1) < 0)
+        lsp_verb(tag, "%s: could not wake rx task of %s\n", __FUNCTION__, iface->ifname);
+    rc = lsp_thread_join(priv->rx_thread);
+
+    close(priv->fd);
+    close(priv->wakefd[0]);
+    close(priv->wakefd[1]);
+    priv->fd = priv->wakefd[0] = priv->wakefd[1] = -1;
+    return rc;
+}
+
+static int serial_tx(lsp_interface_t *iface, void *data, size_t len)
+{
+    serial_priv_t *priv = lsp_interface_getdata(iface);
+    size_t flen;
+
+    flen = cobs_encode(data, len, priv->txbuf);
+    priv->txbuf[flen++] = 0;
+    if (serial_write(priv->fd, priv->txbuf, flen) != flen)
+    {
+        lsp_verb(tag, "%s: %s write error %s\n", __FUNCTION__, iface->ifname, strerror(errno));
+        return LSP_ERR;
+    }
+    return LSP_ERR_NONE;
+}
+
+static int serial_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    serial_priv_t *priv = lsp_interface_getdata(iface);
+    size_t ends[LSP_DEFAULT_IF_TX_BURST];
+    size_t written, len = 0;
+    int sent = 0;
+
+    if (n > LSP_DEFAULT_IF_TX_BURST)
+        n = LSP_DEFAULT_IF_TX_BURST;
+
+    // encode the whole burst back to back and write it with a single call
+    for (int i = 0; i < n; ++i)
+    {
+        len += cobs_encode(bufs[i]->data, lsp_buffer_length(bufs[i]), priv->txbuf + len);
+        priv->txbuf[len++] = 0;
+        ends[i] = len;
+    }
+
+    written = serial_write(priv->fd, priv->txbuf, len);
+    while (sent < n && ends[sent] <= written)
+        sent++;
+    if (sent < n)
+        lsp_verb(tag, "%s: %s write error %s\n", __FUNCTION__, iface->ifname, strerror(errno));
+    return sent;
+}
+
+static lsp_interface_ops_t serial_ops = {
+    .open = serial_open,
+    .close = serial_close,
+    .tx = serial_tx,
+    .tx_burst = serial_tx_burst};
+
+int lsp_serial_create(const char *name, int fd, lsp_interface_t **iface)
+{
+    int rc = LSP_ERR_NOMEM;
+    struct termios tio;
+    serial_priv_t *priv;
+    lsp_interface_t *ifp;
+
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        if (tcsetattr(fd, TCSANOW, &tio) != 0)
+            lsp_warn(tag, "%s: could not set %s to raw mode\n", __FUNCTION__, name);
+    }
+
+    ifp = lsp_interface_alloc(LSP_DEFAULT_IF_TXQUEUE_LEN, sizeof(serial_priv_t), "%s", name);
+    if (ifp == NULL)
+        goto err;
+
+    priv = lsp_interface_getdata(ifp);
+    priv->fd = fd;
+    if (pipe(priv->wakefd) < 0)
+    {
+        rc = LSP_ERR;
+        goto pipe_err;
+    }
+    ifp->mtu = SERIAL_MTU;
+    ifp->ops = &serial_ops;
+
+    rc = lsp_interface_register(ifp);
+    if (rc != LSP_ERR_NONE)
+        goto register_err;
+
+    *iface = ifp;
+    return LSP_ERR_NONE;
+
+register_err:
+    // serial_close already closed everything if the interface was opened
+    if (priv->wakefd[0] >= 0)
+    {
+        close(priv->wakefd[0]);
+        close(priv->wakefd[1]);
+    }
+pipe_err:
+    fd = priv->fd;
+    lsp_interface_free(ifp);
+err:
+    if (fd >= 0)
+        close(fd);
+    lsp_err(tag, "%s: could not create %s %d\n", __FUNCTION__, name, rc);
+    return rc;
+}
@@ -0,0 +1,503 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#define _GNU_SOURCE
+
+#include "lsp_shm.h"
+#include "lsp_buffer.h"
+#include "lsp_memory.h"
+#include "lsp_mutex.h"
+#include "lsp_thread.h"
+#include "lsp_log.h"
+
+#include "string.h"
+#include "errno.h"
+#include "inttypes.h"
+#include "time.h"
+#include "unistd.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static const char *tag = "lsp_shm";
+
+#define SHM_MAGIC 0x4C535053 /** "LSPS" */
+#define SHM_SLOTS LSP_DEFAULT_SHM_SLOTS
+#define SHM_SLOT_SIZE LSP_DEFAULT_SHM_SLOT_SIZE
+#define SHM_CACHELINE 64
+
+#if (SHM_SLOTS & (SHM_SLOTS - 1)) || SHM_SLOTS > 0x10000
+#error "LSP_DEFAULT_SHM_SLOTS must be a power of 2 and at most 65536"
+#endif
+
+/** descriptor holds slot index, offset of data in slot and data length */
+#define SHM_DESC(slot, off, len) ((uint64_t)(slot) | (uint64_t)(off) << 16 | (uint64_t)(len) << 32)
+#define SHM_DESC_SLOT(d) ((uint32_t)((d)&0xFFFF))
+#define SHM_DESC_OFF(d) ((uint32_t)(((d) >> 16) & 0xFFFF))
+#define SHM_DESC_LEN(d) ((uint32_t)((d) >> 32))
+
+/** single producer single consumer descriptor ring, indexes are free running */
+typedef struct shm_ring_s
+{
+    uint32_t head __attribute__((aligned(SHM_CACHELINE))); /** consumer index */
+    uint32_t tail __attribute__((aligned(SHM_CACHELINE))); /** producer index */
+    uint64_t desc[SHM_SLOTS] __attribute__((aligned(SHM_CACHELINE)));
+} shm_ring_t;
+
+/** one direction of the link, every slot is always in exactly one ring or held by a buffer */
+typedef struct shm_dir_s
+{
+    shm_ring_t used;                                       /** filled slots, sender to receiver */
+    shm_ring_t free;                                       /** released slots, receiver to sender */
+    uint32_t bell __attribute__((aligned(SHM_CACHELINE))); /** futex word, bumped to wake receiver */
+    uint32_t sleeping;                                     /** receiver waits on bell */
+    uint8_t slots[SHM_SLOTS][SHM_SLOT_SIZE] __attribute__((aligned(SHM_CACHELINE)));
+} shm_dir_t;
+
+typedef struct shm_region_s
+{
+    uint32_t magic;     /** SHM_MAGIC once initialized */
+    uint32_t slots;     /** SHM_SLOTS of creator, both sides must match */
+    uint32_t slot_size; /** SHM_SLOT_SIZE of creator, both sides must match */
+    shm_dir_t dir[2];   /** dir[n] carries packets sent by side n */
+} shm_region_t;
+
+typedef struct shm_priv_s
+{
+    shm_region_t *region;          /** mapped region */
+    shm_dir_t *tx;                 /** direction we send on */
+    shm_dir_t *rx;                 /** direction we receive on */
+    int busy_poll_us;              /** poll time before sleeping */
+    volatile int running;          /** cleared on close to stop rx task */
+    lsp_thread_handle_t rx_thread; /** rx task handle */
+    lsp_mutex_t tx_mutex;          /** serializes tx slot allocation, buffers are allocated from any thread */
+    lsp_mutex_t rx_mutex;          /** serializes rx slot release, buffers are freed from any thread */
+    int nstash;                    /** number of slots in stash */
+    uint16_t stash[SHM_SLOTS];     /** free tx slots taken from the free ring */
+} shm_priv_t;
+
+static inline int ring_push(shm_ring_t *ring, const uint64_t *desc, int n)
+{
+    uint32_t tail = ring->tail;
+    uint32_t space = SHM_SLOTS - (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+
+    if ((uint32_t)n > space)
+        n = space;
+    for (int i = 0; i < n; ++i)
+        ring->desc[(tail + i) & (SHM_SLOTS - 1)] = desc[i];
+    __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+static inline int ring_pop(shm_ring_t *ring, uint64_t *desc, int n)
+{
+    uint32_t head = ring->head;
+    uint32_t avail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head;
+
+    if ((uint32_t)n > avail)
+        n = avail;
+    for (int i = 0; i < n; ++i)
+        desc[i] = ring->desc[(head + i) & (SHM_SLOTS - 1)];
+    __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+static inline int ring_empty(shm_ring_t *ring)
+{
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->head;
+}
+
+static inline long futex(uint32_t *addr, int op, uint32_t val, const struct timespec *ts)
+{
+    return syscall(SYS_futex, addr, op, val, ts, NULL, 0);
+}
+
+/** wakes the receiver of dir if it is sleeping, called after publishing to the used ring */
+static inline void shm_doorbell(shm_dir_t *dir)
+{
+    // pairs with the fence in shm_rx_wait, either we see sleeping or receiver sees the new tail
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&dir->sleeping, __ATOMIC_RELAXED))
+    {
+        __atomic_add_fetch(&dir->bell, 1, __ATOMIC_RELEASE);
+        futex(&dir->bell, FUTEX_WAKE, 1, NULL);
+    }
+}
+
+static inline uint32_t shm_slot_index(shm_dir_t *dir, lsp_buffer_t *buff)
+{
+    return (buff->head - dir->slots[0]) / SHM_SLOT_SIZE;
+}
+
+/** takes a free tx slot, returns -1 if all slots are in flight */
+static int shm_slot_get(shm_priv_t *priv)
+{
+    uint64_t desc[LSP_DEFAULT_IF_TX_BURST];
+    uint32_t index;
+    int n, slot = -1;
+
+    lsp_mutex_lock(&priv->tx_mutex, LSP_TIMEOUT_MAX);
+    if (priv->nstash == 0)
+    {
+        n = ring_pop(&priv->tx->free, desc, LSP_DEFAULT_IF_TX_BURST);
+        for (int i = 0; i < n; ++i)
+        {
+            // free ring is written by the peer, never trust its slot numbers
+            index = SHM_DESC_SLOT(desc[i]);
+            if (index >= SHM_SLOTS)
+            {
+                lsp_err(tag, "%s: peer released invalid slot %u\n", __FUNCTION__, index);
+                continue;
+            }
+            priv->stash[priv->nstash++] = index;
+        }
+    }
+    if (priv->nstash > 0)
+        slot = priv->stash[--priv->nstash];
+    lsp_mutex_unlock(&priv->tx_mutex);
+    return slot;
+}
+
+static void shm_slot_put(shm_priv_t *priv, uint32_t slot)
+{
+    lsp_mutex_lock(&priv->tx_mutex, LSP_TIMEOUT_MAX);
+    // a peer releasing slots twice could otherwise overrun the stash
+    if (slot < SHM_SLOTS && priv->nstash < SHM_SLOTS)
+        priv->stash[priv->nstash++] = slot;
+    else
+        lsp_err(tag, "%s: dropping slot %u, stash holds %d\n", __FUNCTION__, slot, priv->nstash);
+    lsp_mutex_unlock(&priv->tx_mutex);
+}
+
+/** tx buffer freed before it was handed to the peer */
+static void shm_tx_release(lsp_buffer_t *buff)
+{
+    shm_priv_t *priv = lsp_interface_getdata(buff->release_arg);
+    shm_slot_put(priv, shm_slot_index(priv->tx, buff));
+}
+
+/** gives an rx slot back to the peer, the free ring has one producer so pushes are serialized */
+static void shm_rx_recycle(shm_priv_t *priv, uint32_t slot)
+{
+    uint64_t desc = SHM_DESC(slot, 0, 0);
+
+    lsp_mutex_lock(&priv->rx_mutex, LSP_TIMEOUT_MAX);
+    ring_push(&priv->rx->free, &desc, 1);
+    lsp_mutex_unlock(&priv->rx_mutex);
+}
+
+/** rx buffer consumed by the stack, slot goes back to the peer */
+static void shm_rx_release(lsp_buffer_t *buff)
+{
+    lsp_interface_t *iface = buff->release_arg;
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+
+    shm_rx_recycle(priv, shm_slot_index(priv->rx, buff));
+    // unregister may free iface and priv from here on
+    lsp_interface_rx_return(iface);
+}
+
+static uint64_t shm_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** polls for busy_poll_us, then sleeps on the doorbell until the peer sends */
+static void shm_rx_wait(shm_priv_t *priv)
+{
+    // timeout only so that close is noticed
+    const struct timespec ts = {.tv_sec = 0, .tv_nsec = 100000000};
+    shm_dir_t *dir = priv->rx;
+    uint64_t start;
+    uint32_t seq;
+
+    if (priv->busy_poll_us > 0)
+    {
+        start = shm_now_us();
+        while (shm_now_us() - start < (uint64_t)priv->busy_poll_us)
+        {
+            if (!ring_empty(&dir->used))
+                return;
+        }
+    }
+
+    __atomic_store_n(&dir->sleeping, 1, __ATOMIC_RELAXED);
+    seq = __atomic_load_n(&dir->bell, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (ring_empty(&dir->used) && priv->running)
+        futex(&dir->bell, FUTEX_WAIT, seq, &ts);
+    __atomic_store_n(&dir->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+static lsp_thread_return_t shm_rx_task(void *arg)
+{
+    lsp_interface_t *iface = arg;
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_buffer_t *bufs[LSP_DEFAULT_IF_RX_BURST];
+    uint64_t desc[LSP_DEFAULT_IF_RX_BURST];
+    uint32_t slot, off, len;
+    int i, n, count;
+
+    while (priv->running)
+    {
+        n = ring_pop(&priv->rx->used, desc, LSP_DEFAULT_IF_RX_BURST);
+        if (n == 0)
+        {
+            shm_rx_wait(priv);
+            continue;
+        }
+
+        // buffers point into the peer's slots, slots are released when the stack frees them
+        count = 0;
+        for (i = 0; i < n; ++i)
+        {
+            slot = SHM_DESC_SLOT(desc[i]);
+            off = SHM_DESC_OFF(desc[i]);
+            len = SHM_DESC_LEN(desc[i]);
+
+            // the peer is another process, never index the mapping with what it sent unchecked
+            if (slot >= SHM_SLOTS || off > SHM_SLOT_SIZE || len > SHM_SLOT_SIZE - off)
+            {
+                lsp_verb(tag, "%s: %s bad descriptor %016" PRIx64 "\n", __FUNCTION__, iface->ifname, desc[i]);
+                LSP_IF_STATS_INC(iface, rx_error);
+                if (slot < SHM_SLOTS)
+                    shm_rx_recycle(priv, slot);
+                continue;
+            }
+
+            bufs[count] = lsp_buffer_wrap(iface, priv->rx->slots[slot], SHM_SLOT_SIZE,
+                                          off, shm_rx_release, iface);
+            if (bufs[count] == NULL)
+            {
+                LSP_IF_STATS_INC(iface, dropped);
+                shm_rx_recycle(priv, slot);
+                continue;
+            }
+            lsp_interface_rx_lend(iface);
+            lsp_buffer_put(bufs[count++], len);
+        }
+
+        if (count > 0)
+            lsp_interface_rx_burst(iface, bufs, count);
+    }
+    return (lsp_thread_return_t)0;
+}
+
+static int shm_iface_open(lsp_interface_t *iface)
+{
+    int rc;
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+
+    priv->running = 1;
+    rc = lsp_thread_create(shm_rx_task, iface->ifname, LSP_DEFAULT_CORE_STACK_SIZE,
+                           iface, LSP_DEFAULT_CORE_PRIORITY, &priv->rx_thread);
+    if (rc != LSP_ERR_NONE)
+    {
+        lsp_err(tag, "%s: could not create rx task for %s\n", __FUNCTION__, iface->ifname);
+        priv->running = 0;
+    }
+    return rc;
+}
+
+static int shm_iface_close(lsp_interface_t *iface)
+{
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+
+    // region stays mapped, buffers may still point into it
+    priv->running = 0;
+    __atomic_add_fetch(&priv->rx->bell, 1, __ATOMIC_RELEASE);
+    futex(&priv->rx->bell, FUTEX_WAKE, 1, NULL);
+    return lsp_thread_join(priv->rx_thread);
+}
+
+static lsp_buffer_t *shm_alloc(lsp_interface_t *iface, size_t len)
+{
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_buffer_t *buff;
+    int slot;
+
+    if (len + iface->min_header_len > SHM_SLOT_SIZE)
+        return NULL;
+
+    slot = shm_slot_get(priv);
+    if (slot < 0)
+        return NULL;
+
+    buff = lsp_buffer_wrap(iface, priv->tx->slots[slot], SHM_SLOT_SIZE, iface->min_header_len, shm_tx_release, iface);
+    if (buff == NULL)
+        shm_slot_put(priv, slot);
+    return buff;
+}
+
+static int shm_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+    uint64_t desc[LSP_DEFAULT_IF_TX_BURST];
+    lsp_buffer_t *buff;
+    size_t len;
+    int i, slot;
+
+    if (n > LSP_DEFAULT_IF_TX_BURST)
+        n = LSP_DEFAULT_IF_TX_BURST;
+
+    for (i = 0; i < n; ++i)
+    {
+        buff = bufs[i];
+        len = lsp_buffer_length(buff);
+        if (buff->release == shm_tx_release && buff->release_arg == iface)
+        {
+            // already in one of our slots, hand it over as is
+            desc[i] = SHM_DESC(shm_slot_index(priv->tx, buff), buff->data - buff->head, len);
+            buff->release = NULL;
+            continue;
+        }
+
+        // heap buffer or buffer from another interface, copy once into a slot
+        if (len > SHM_SLOT_SIZE || (slot = shm_slot_get(priv)) < 0)
+            break;
+        memcpy(priv->tx->slots[slot], buff->data, len);
+        desc[i] = SHM_DESC(slot, 0, len);
+    }
+
+    // used ring can hold every slot, push never comes up short
+    ring_push(&priv->tx->used, desc, i);
+    shm_doorbell(priv->tx);
+    return i;
+}
+
+static int shm_tx(lsp_interface_t *iface, void *data, size_t len)
+{
+    shm_priv_t *priv = lsp_interface_getdata(iface);
+    uint64_t desc;
+    int slot;
+
+    if (len > SHM_SLOT_SIZE || (slot = shm_slot_get(priv)) < 0)
+        return LSP_ERR_NOMEM;
+
+    memcpy(priv->tx->slots[slot], data, len);
+    desc = SHM_DESC(slot, 0, len);
+    ring_push(&priv->tx->used, &desc, 1);
+    shm_doorbell(priv->tx);
+    return LSP_ERR_NONE;
+}
+
+static lsp_interface_ops_t shm_ops = {
+    .open = shm_iface_open,
+    .close = shm_iface_close,
+    .tx = shm_tx,
+    .tx_burst = shm_tx_burst,
+    .alloc = shm_alloc};
+
+int lsp_shm_region_create()
+{
+    int fd;
+    shm_region_t *region;
+
+    fd = memfd_create("lsp_shm", 0);
+    if (fd < 0)
+    {
+        lsp_err(tag, "%s: memfd_create error %s\n", __FUNCTION__, strerror(errno));
+        return -LSP_ERR;
+    }
+
+    if (ftruncate(fd, sizeof(shm_region_t)) < 0)
+        goto err;
+
+    region = mmap(NULL, sizeof(shm_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED)
+        goto err;
+
+    // ftruncate zero fills, only free rings need setup. all slots start with the sender
+    for (int d = 0; d < 2; ++d)
+    {
+        for (uint32_t i = 0; i < SHM_SLOTS; ++i)
+            region->dir[d].free.desc[i] = SHM_DESC(i, 0, 0);
+        region->dir[d].free.tail = SHM_SLOTS;
+    }
+    region->slots = SHM_SLOTS;
+    region->slot_size = SHM_SLOT_SIZE;
+    __atomic_store_n(&region->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    munmap(region, sizeof(shm_region_t));
+    return fd;
+
+err:
+    lsp_err(tag, "%s: could not set up region %s\n", __FUNCTION__, strerror(errno));
+    close(fd);
+    return -LSP_ERR_NOMEM;
+}
+
+int lsp_shm_create(const char *name, int fd, int side, int busy_poll_us, lsp_interface_t **iface)
+{
+    int rc = LSP_ERR_INVALID;
+    shm_region_t *region;
+    shm_priv_t *priv;
+    lsp_interface_t *ifp;
+
+    if (side != 0 && side != 1)
+        goto err;
+
+    region = mmap(NULL, sizeof(shm_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED)
+    {
+        lsp_err(tag, "%s: could not map region %s\n", __FUNCTION__, strerror(errno));
+        goto err;
+    }
+
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+        region->slots != SHM_SLOTS || region->slot_size != SHM_SLOT_SIZE)
+    {
+        lsp_err(tag, "%s: region layout mismatch\n", __FUNCTION__);
+        goto map_err;
+    }
+
+    rc = LSP_ERR_NOMEM;
+    ifp = lsp_interface_alloc(LSP_DEFAULT_IF_TXQUEUE_LEN, sizeof(shm_priv_t), "%s", name);
+    if (ifp == NULL)
+        goto map_err;
+
+    priv = lsp_interface_getdata(ifp);
+    priv->region = region;
+    priv->tx = &region->dir[side];
+    priv->rx = &region->dir[!side];
+    priv->busy_poll_us = busy_poll_us;
+    lsp_mutex_init(&priv->tx_mutex);
+    lsp_mutex_init(&priv->rx_mutex);
+    ifp->mtu = SHM_SLOT_SIZE;
+    ifp->flags |= LSP_IF_FLAGS_ZERO_COPY;
+    ifp->ops = &shm_ops;
+
+    rc = lsp_interface_register(ifp);
+    if (rc != LSP_ERR_NONE)
+        goto register_err;
+
+    *iface = ifp;
+    return LSP_ERR_NONE;
+
+register_err:
+    lsp_interface_free(ifp);
+map_err:
+    munmap(region, sizeof(shm_region_t));
+err:
+    lsp_err(tag, "%s: could not create %s %d\n", __FUNCTION__, name, rc);
+    return rc;
+}
@@ -0,0 +1,299 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#define _GNU_SOURCE
+
+#include "lsp_udp.h"
+#include "lsp_buffer.h"
+#include "lsp_thread.h"
+#include "lsp_log.h"
+
+#include "string.h"
+#include "errno.h"
+#include "unistd.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static const char *tag = "lsp_udp";
+
+/** largest lsp packet, one per datagram */
+#define UDP_MTU (sizeof(lsp_packet_t) + LSP_PACKET_PLEN_MAX)
+
+typedef struct udp_priv_s
+{
+    int fd;                          /** datagram socket */
+    struct sockaddr_storage raddr;   /** remote endpoint */
+    socklen_t raddrlen;              /** length of raddr */
+    volatile int running;            /** cleared on close to stop rx task */
+    lsp_thread_handle_t rx_thread;   /** rx task handle */
+} udp_priv_t;
+
+static lsp_thread_return_t udp_rx_task(void *arg)
+{
+    lsp_interface_t *iface = arg;
+    udp_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_buffer_t *bufs[LSP_DEFAULT_IF_RX_BURST] = {0};
+    lsp_buffer_t *batch[LSP_DEFAULT_IF_RX_BURST];
+    struct mmsghdr msgs[LSP_DEFAULT_IF_RX_BURST];
+    struct iovec iovs[LSP_DEFAULT_IF_RX_BURST];
+    int i, n, count;
+
+    while (priv->running)
+    {
+        // refill the slots handed to core on the previous batch
+        for (i = 0; i < LSP_DEFAULT_IF_RX_BURST; ++i)
+        {
+            if (bufs[i] == NULL && (bufs[i] = lsp_buffer_alloc(iface, iface->mtu)) == NULL)
+                break;
+            iovs[i].iov_base = bufs[i]->data;
+            iovs[i].iov_len = iface->mtu;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        if (i == 0)
+        {
+            usleep(1000);
+            continue;
+        }
+
+        // block for the first datagram, then take whatever else is pending
+        n = recvmmsg(priv->fd, msgs, i, MSG_WAITFORONE, NULL);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EINTR && priv->running)
+            {
+                lsp_err(tag, "%s: %s recvmmsg error %s\n", __FUNCTION__, iface->ifname, strerror(errno));
+                LSP_IF_STATS_INC(iface, rx_error);
+            }
+            continue;
+        }
+
+        count = 0;
+        for (i = 0; i < n; ++i)
+        {
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                LSP_IF_STATS_INC(iface, rx_error);
+                continue;
+            }
+            lsp_buffer_put(bufs[i], msgs[i].msg_len);
+            batch[count++] = bufs[i];
+            bufs[i] = NULL;
+        }
+
+        if (count > 0)
+            lsp_interface_rx_burst(iface, batch, count);
+    }
+
+    for (i = 0; i < LSP_DEFAULT_IF_RX_BURST; ++i)
+    {
+        if (bufs[i] != NULL)
+            lsp_buffer_free(bufs[i]);
+    }
+    return (lsp_thread_return_t)0;
+}
+
+static int udp_open(lsp_interface_t *iface)
+{
+    int rc;
+    udp_priv_t *priv = lsp_interface_getdata(iface);
+
+    priv->running = 1;
+    rc = lsp_thread_create(udp_rx_task, iface->ifname, LSP_DEFAULT_CORE_STACK_SIZE,
+                           iface, LSP_DEFAULT_CORE_PRIORITY, &priv->rx_thread);
+    if (rc != LSP_ERR_NONE)
+    {
+        lsp_err(tag, "%s: could not create rx task for %s\n", __FUNCTION__, iface->ifname);
+        priv->running = 0;
+    }
+    return rc;
+}
+
+static int udp_close(lsp_interface_t *iface)
+{
+    int rc;
+    udp_priv_t *priv = lsp_interface_getdata(iface);
+
+    // wakes rx task from recvmmsg, the socket is closed once the task is gone
+    priv->running = 0;
+    shutdown(priv->fd, SHUT_RDWR);
+    rc = lsp_thread_join(priv->rx_thread);
+    close(priv->fd);
+    priv->fd = -1;
+    return rc;
+}
+
+static int udp_tx(lsp_interface_t *iface, void *data, size_t len)
+{
+    udp_priv_t *priv = lsp_interface_getdata(iface);
+
+    if (sendto(priv->fd, data, len, 0, (struct sockaddr *)&priv->raddr, priv->raddrlen) < 0)
+    {
+        lsp_verb(tag, "%s: %s sendto error %s\n", __FUNCTION__, iface->ifname, strerror(errno));
+        return LSP_ERR;
+    }
+    return LSP_ERR_NONE;
+}
+
+static int udp_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    udp_priv_t *priv = lsp_interface_getdata(iface);
+    struct mmsghdr msgs[LSP_DEFAULT_IF_TX_BURST];
+    struct iovec iovs[LSP_DEFAULT_IF_TX_BURST];
+    int rc, sent = 0;
+
+    if (n > LSP_DEFAULT_IF_TX_BURST)
+        n = LSP_DEFAULT_IF_TX_BURST;
+
+    memset(msgs, 0, n * sizeof(msgs[0]));
+    for (int i = 0; i < n; ++i)
+    {
+        iovs[i].iov_base = bufs[i]->data;
+        iovs[i].iov_len = lsp_buffer_length(bufs[i]);
+        msgs[i].msg_hdr.msg_name = &priv->raddr;
+        msgs[i].msg_hdr.msg_namelen = priv->raddrlen;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg may stop early, retry from the first unsent datagram
+    while (sent < n)
+    {
+        rc = sendmmsg(priv->fd, &msgs[sent], n - sent, 0);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            lsp_verb(tag, "%s: %s sendmmsg error %s\n", __FUNCTION__, iface->ifname, strerror(errno));
+            break;
+        }
+        sent += rc;
+    }
+    return sent;
+}
+
+static lsp_interface_ops_t udp_ops = {
+    .open = udp_open,
+    .close = udp_close,
+    .tx = udp_tx,
+    .tx_burst = udp_tx_burst};
+
+/** allocates and registers the interface over an already bound socket, closes fd on error */
+static int udp_create(const char *name, int fd, const struct sockaddr *raddr, socklen_t raddrlen, lsp_interface_t **iface)
+{
+    int rc = LSP_ERR_NOMEM;
+    udp_priv_t *priv;
+    lsp_interface_t *ifp;
+
+    ifp = lsp_interface_alloc(LSP_DEFAULT_IF_TXQUEUE_LEN, sizeof(udp_priv_t), "%s", name);
+    if (ifp == NULL)
+        goto err;
+
+    priv = lsp_interface_getdata(ifp);
+    priv->fd = fd;
+    memcpy(&priv->raddr, raddr, raddrlen);
+    priv->raddrlen = raddrlen;
+    ifp->mtu = UDP_MTU;
+    ifp->ops = &udp_ops;
+
+    rc = lsp_interface_register(ifp);
+    if (rc != LSP_ERR_NONE)
+        goto register_err;
+
+    *iface = ifp;
+    return LSP_ERR_NONE;
+
+register_err:
+    // udp_close already closed fd if the interface was opened
+    fd = priv->fd;
+    lsp_interface_free(ifp);
+err:
+    if (fd >= 0)
+        close(fd);
+    lsp_err(tag, "%s: could not create %s %d\n", __FUNCTION__, name, rc);
+    return rc;
+}
+
+int lsp_udp_create_inet(const char *name, const char *lhost, uint16_t lport,
+                        const char *rhost, uint16_t rport, lsp_interface_t **iface)
+{
+    int fd;
+    struct sockaddr_in laddr = {.sin_family = AF_INET, .sin_port = htons(lport)};
+    struct sockaddr_in raddr = {.sin_family = AF_INET, .sin_port = htons(rport)};
+
+    laddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ((lhost != NULL && inet_pton(AF_INET, lhost, &laddr.sin_addr) != 1) ||
+        inet_pton(AF_INET, rhost, &raddr.sin_addr) != 1)
+    {
+        lsp_err(tag, "%s: invalid address for %s\n", __FUNCTION__, name);
+        return LSP_ERR_INVALID;
+    }
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        lsp_err(tag, "%s: socket error %s\n", __FUNCTION__, strerror(errno));
+        return LSP_ERR;
+    }
+
+    if (bind(fd, (struct sockaddr *)&laddr, sizeof(laddr)) < 0)
+    {
+        lsp_err(tag, "%s: could not bind %s to port %u %s\n", __FUNCTION__, name, lport, strerror(errno));
+        close(fd);
+        return LSP_ERR;
+    }
+
+    return udp_create(name, fd, (struct sockaddr *)&raddr, sizeof(raddr), iface);
+}
+
+int lsp_udp_create_unix(const char *name, const char *lpath, const char *rpath, lsp_interface_t **iface)
+{
+    int fd;
+    struct sockaddr_un laddr = {.sun_family = AF_UNIX};
+    struct sockaddr_un raddr = {.sun_family = AF_UNIX};
+
+    if (strlen(lpath) >= sizeof(laddr.sun_path) || strlen(rpath) >= sizeof(raddr.sun_path))
+    {
+        lsp_err(tag, "%s: socket path too long for %s\n", __FUNCTION__, name);
+        return LSP_ERR_INVALID;
+    }
+    strcpy(laddr.sun_path, lpath);
+    strcpy(raddr.sun_path, rpath);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        lsp_err(tag, "%s: socket error %s\n", __FUNCTION__, strerror(errno));
+        return LSP_ERR;
+    }
+
+    unlink(lpath);
+    if (bind(fd, (struct sockaddr *)&laddr, sizeof(laddr)) < 0)
+    {
+        lsp_err(tag, "%s: could not bind %s to %s %s\n", __FUNCTION__, name, lpath, strerror(errno));
+        close(fd);
+        return LSP_ERR;
+    }
+
+    return udp_create(name, fd, (struct sockaddr *)&raddr, sizeof(raddr), iface);
+}
@@ -0,0 +1,173 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_veth.h"
+#include "lsp_buffer.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+static const char *tag = "lsp_veth";
+
+typedef struct veth_priv_s
+{
+    lsp_interface_t *peer; /** other end of the pair */
+} veth_priv_t;
+
+static int veth_open(lsp_interface_t *iface)
+{
+    (void)iface; // unused
+    return LSP_ERR_NONE;
+}
+
+static int veth_close(lsp_interface_t *iface)
+{
+    veth_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_interface_t *peer = __atomic_exchange_n(&priv->peer, NULL, __ATOMIC_ACQ_REL);
+
+    // other end drops packets from now on instead of delivering to a removed interface
+    if (peer != NULL)
+        __atomic_store_n(&((veth_priv_t *)lsp_interface_getdata(peer))->peer, NULL, __ATOMIC_RELEASE);
+    return LSP_ERR_NONE;
+}
+
+/** copies data into a buffer owned by peer */
+static inline lsp_buffer_t *veth_copy(lsp_interface_t *peer, const void *data, size_t len)
+{
+    lsp_buffer_t *buff = lsp_buffer_alloc(peer, len);
+    if (buff != NULL)
+        memcpy(lsp_buffer_put(buff, len), data, len);
+    return buff;
+}
+
+static int veth_tx(lsp_interface_t *iface, void *data, size_t len)
+{
+    veth_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_interface_t *peer = __atomic_load_n(&priv->peer, __ATOMIC_ACQUIRE);
+    lsp_buffer_t *buff;
+
+    if (peer == NULL)
+        return LSP_ERR_ADDR_NOTFOUND;
+
+    buff = veth_copy(peer, data, len);
+    if (buff == NULL)
+        return LSP_ERR_NOMEM;
+
+    return lsp_interface_rx_burst(peer, &buff, 1) == 1 ? LSP_ERR_NONE : LSP_ERR_QUEUE_FULL;
+}
+
+/** peer consumed a buffer lent by veth_tx_burst, original completes on the sending end */
+static void veth_peer_release(lsp_buffer_t *buff)
+{
+    lsp_buffer_t *orig = buff->release_arg;
+    lsp_interface_tx_complete(orig->iface, &orig, 1);
+}
+
+/** lends the memory of buff to peer without copying */
+static inline lsp_buffer_t *veth_lend(lsp_interface_t *peer, lsp_buffer_t *buff)
+{
+    size_t len = lsp_buffer_length(buff);
+    lsp_buffer_t *lent = lsp_buffer_wrap(peer, buff->head, buff->end - buff->head,
+                                         buff->data - buff->head, veth_peer_release, buff);
+    if (lent != NULL)
+    {
+        lsp_buffer_put(lent, len);
+        lent->priority = buff->priority;
+    }
+    return lent;
+}
+
+static int veth_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    veth_priv_t *priv = lsp_interface_getdata(iface);
+    lsp_interface_t *peer = __atomic_load_n(&priv->peer, __ATOMIC_ACQUIRE);
+    lsp_buffer_t *lent[LSP_DEFAULT_IF_TX_BURST];
+    int i;
+
+    if (peer == NULL)
+        return 0;
+
+    if (n > LSP_DEFAULT_IF_TX_BURST)
+        n = LSP_DEFAULT_IF_TX_BURST;
+
+    for (i = 0; i < n; ++i)
+    {
+        lent[i] = veth_lend(peer, bufs[i]);
+        if (lent[i] == NULL)
+            break;
+    }
+
+    // buffers dropped by peer are freed right away, which completes them as well
+    if (i > 0)
+        lsp_interface_rx_burst(peer, lent, i);
+    return i;
+}
+
+static lsp_interface_ops_t veth_ops = {
+    .open = veth_open,
+    .close = veth_close,
+    .tx = veth_tx,
+    .tx_burst = veth_tx_burst};
+
+int lsp_veth_create(const char *name, int tx_queuelen, lsp_interface_t **end0, lsp_interface_t **end1)
+{
+    int rc = LSP_ERR_NOMEM;
+    lsp_interface_t *a, *b;
+
+    a = lsp_interface_alloc(tx_queuelen, sizeof(veth_priv_t), "%s0", name);
+    if (a == NULL)
+        goto err;
+
+    b = lsp_interface_alloc(tx_queuelen, sizeof(veth_priv_t), "%s1", name);
+    if (b == NULL)
+        goto b_err;
+
+    ((veth_priv_t *)lsp_interface_getdata(a))->peer = b;
+    ((veth_priv_t *)lsp_interface_getdata(b))->peer = a;
+    a->ops = &veth_ops;
+    b->ops = &veth_ops;
+    a->flags |= LSP_IF_FLAGS_ZERO_COPY | LSP_IF_FLAGS_TX_ASYNC;
+    b->flags |= LSP_IF_FLAGS_ZERO_COPY | LSP_IF_FLAGS_TX_ASYNC;
+
+    rc = lsp_interface_register(a);
+    if (rc != LSP_ERR_NONE)
+        goto register_err;
+
+    // iflist may be full or the name taken, a must not lend buffers to an unregistered peer
+    rc = lsp_interface_register(b);
+    if (rc != LSP_ERR_NONE)
+    {
+        lsp_interface_unregister(a);
+        lsp_interface_free(b);
+        goto err;
+    }
+
+    *end0 = a;
+    *end1 = b;
+    return LSP_ERR_NONE;
+
+register_err:
+    lsp_interface_free(b);
+b_err:
+    lsp_interface_free(a);
+err:
+    lsp_err(tag, "%s: could not create %s pair %d\n", __FUNCTION__, name, rc);
+    return rc;
+}
@@ -25,7 +25,16 @@
 
 #include "lsp_types.h"
 
-#ifdef LSP_POSIX
+#if (LSP_CORE_POLL)
+typedef struct lsp_egroup_handle_s *lsp_egroup_handle_t;
+typedef uint32_t lsp_egroup_bits_t;
+
+struct lsp_egroup_handle_s
+{
+    lsp_egroup_bits_t event_bits;
+};
+
+#elif defined(LSP_POSIX)
 #include <pthread.h>
 
 typedef struct lsp_egroup_handle_s *lsp_egroup_handle_t;
@@ -23,6 +23,7 @@
 #include <stddef.h>
 
 #include "lsp_types.h"
+#include "lsp_spin.h"
 
 typedef void * lsp_queue_handle_t;
 
@@ -61,6 +62,51 @@ int lsp_queue_push(lsp_queue_handle_t handle, const void *const data, const uint
  */
 int lsp_queue_pop(lsp_queue_handle_t handle, void *data, const uint32_t timeout);
 
+/**
+ * @brief pushes up to n items to queue with a single lock and a single wakeup,
+ * blocks only if the queue is full
+ * 
+ * @param handle pointer to queue handle
+ * @param data pointer to array of n items
+ * @param n number of items to push
+ * @param timeout timeout in ms, LSP_TIMEOUT_MAX to wait forever
+ * @return int number of items pushed, items after that did not fit in queue
+ */
+int lsp_queue_push_burst(lsp_queue_handle_t handle, const void *const data, int n, const uint32_t timeout);
+
+/**
+ * @brief pops up to n items from queue with a single lock, 
+ * blocks only if the queue is empty
+ * 
+ * @param handle pointer to queue handle
+ * @param data pointer to array of at least n items
+ * @param n max number of items to pop
+ * @param timeout timeout in ms, LSP_TIMEOUT_MAX to wait forever
+ * @return int number of items popped, 0 if queue is empty on timeout
+ */
+int lsp_queue_pop_burst(lsp_queue_handle_t handle, void *data, int n, const uint32_t timeout);
+
+/**
+ * @brief sets how long lsp_queue_pop may busy poll an empty queue before it 
+ * blocks, the actual spin adapts to recent waits and stays within the budget.
+ * Resets the wait statistics
+ * 
+ * @param handle pointer to queue handle
+ * @param spin_us spin budget in us, 0 to always block
+ * @return int #LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_queue_set_spin(lsp_queue_handle_t handle, uint32_t spin_us);
+
+/**
+ * @brief returns the spin budget and the wait statistics of lsp_queue_pop
+ * 
+ * @param handle pointer to queue handle
+ * @param spin_us reference to spin budget in us, may be NULL
+ * @param stats reference to stats, may be NULL
+ * @return int #LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_queue_getspin(lsp_queue_handle_t handle, uint32_t *spin_us, lsp_spin_stats_t *stats);
+
 /**
  * @brief returns the length of queue
  * 
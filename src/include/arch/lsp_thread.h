@@ -39,6 +39,10 @@ typedef void * lsp_thread_return_t;
  * @brief Platform specific thread function
  */
 typedef lsp_thread_return_t (*lsp_thread_func_t)(void *arg);
+/**
+ * @brief Platform specific key of a thread local value
+ */
+typedef pthread_key_t lsp_thread_key_t;
 
 #else 
 /**
@@ -53,16 +57,21 @@ typedef void lsp_thread_return_t;
  * @brief Platform specific thread function
  */
 typedef lsp_thread_return_t (*lsp_thread_func_t)(void *arg);
+/**
+ * @brief Platform specific key of a thread local value
+ */
+typedef int lsp_thread_key_t;
 #endif
 
 /**
  * @brief LSP wrapper for creating threads
  * 
  * @param func thread function
- * @param name name of thread
- * @param stack_size stack size of thread
+ * @param name name of thread, shown by debuggers and profilers
+ * @param stack_size stack size of thread, in bytes on posix, 0 for the platform default
  * @param parameter parameter for thread function
- * @param priority thread priority
+ * @param priority thread priority up to LSP_DEFAULT_THREAD_PRIORITY_MAX, 
+ * applied when LSP_DEFAULT_THREAD_SCHED selects a real time policy
  * @param handle reference to created thread
  * @return int LSP_ERR_NONE for success, otherwise an error code
  */
@@ -73,4 +82,74 @@ int lsp_thread_create(lsp_thread_func_t func,
     unsigned int priority,
     lsp_thread_handle_t *handle);
 
+/**
+ * @brief restricts a thread to a set of cpus
+ * 
+ * @param handle thread
+ * @param cpus allowed cpus, 0 to allow all cpus
+ * @return int LSP_ERR_NONE for success, otherwise an error code
+ */
+int lsp_thread_setaffinity(lsp_thread_handle_t handle, lsp_cpumask_t cpus);
+
+/**
+ * @brief waits until a thread returns
+ * 
+ * @param handle thread
+ * @return int LSP_ERR_NONE for success, otherwise an error code
+ */
+int lsp_thread_join(lsp_thread_handle_t handle);
+
+/**
+ * @brief creates a key for a thread local value
+ * 
+ * @param key reference to created key
+ * @param destructor called with the value of a thread that exits with a value other than NULL, may be NULL
+ * @return int LSP_ERR_NONE for success, otherwise an error code
+ */
+int lsp_thread_key_create(lsp_thread_key_t *key, void (*destructor)(void *value));
+
+/**
+ * @brief deletes a key, destructors are not called for the values still set
+ * 
+ * @param key key
+ */
+void lsp_thread_key_delete(lsp_thread_key_t key);
+
+/**
+ * @brief sets the value of a key for the calling thread
+ * 
+ * @param key key
+ * @param value value, NULL to clear
+ * @return int LSP_ERR_NONE for success, otherwise an error code
+ */
+int lsp_thread_key_set(lsp_thread_key_t key, void *value);
+
+/**
+ * @brief suspends the calling thread
+ * 
+ * @param ms time to sleep in ms
+ */
+void lsp_thread_sleep(uint32_t ms);
+
+#ifdef LSP_POSIX
+/**
+ * @brief hints the cpu that the caller is busy waiting
+ */
+static inline void lsp_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+#else
+/**
+ * @brief hints the cpu that the caller is busy waiting
+ */
+void lsp_cpu_relax(void);
+#endif
+
 #endif
\ No newline at end of file
@@ -37,6 +37,13 @@ uint32_t lsp_uptime();
  */
 uint32_t lsp_gettime_ms();
 
+/**
+ * @brief returns current time in us, wraps around after ~71 minutes
+ * 
+ * @return uint32_t time in us
+ */
+uint32_t lsp_gettime_us();
+
 /**
  * @brief returns current time in seconds
  * 
@@ -24,7 +24,7 @@
 
 #include "lsp_types.h"
 
-const lsp_conf_t * const lsp_conf;
+extern const lsp_conf_t * const lsp_conf;
 
 struct lsp_conf_s
 {
@@ -36,6 +36,14 @@ struct lsp_conf_s
 
     uint8_t conn_max;
     uint8_t conn_queuelen;
+
+    uint8_t tx_workers;    /** give every registered interface its own tx worker thread */
+    lsp_cpumask_t tx_cpus; /** cpus tx workers are pinned to, 0 for any cpu */
+
+    uint8_t core_workers;    /** number of core workers, rx flows are sharded between them */
+    lsp_cpumask_t core_cpus; /** cpus core workers are spread over one per cpu, 0 for any cpu */
+    uint8_t core_budget;     /** max events a core worker handles before running timers */
+    uint16_t core_spin_us;   /** max time an idle core worker busy polls its queue before sleeping, 0 to always sleep */
 };
 
 /**
@@ -46,4 +54,12 @@ struct lsp_conf_s
  */
 int lsp_init(lsp_conf_t *conf);
 
+/**
+ * @brief Loads the system configuration. Called by lsp_init
+ * 
+ * @param conf pointer to configuration, leave NULL for defaults
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_conf_init(lsp_conf_t *conf);
+
 #endif
\ No newline at end of file
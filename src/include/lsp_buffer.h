@@ -53,6 +53,10 @@ struct lsp_buffer_s
     unsigned char *data, *tail, *end;
     lsp_packet_t *lsp_packet;
     unsigned char *head;
+    uint8_t priority;                    /** priority of the sending connection, LSP_CONN_PRIO_DEF otherwise */
+    void (*release)(lsp_buffer_t *buff); /** optional, returns driver owned memory on free */
+    void *release_arg;                   /** driver data for release */
+    uint32_t tx_time;                    /** time in us when handed to an asynchronous driver */
 };
 
 /**
@@ -64,6 +68,21 @@ struct lsp_buffer_s
  */
 lsp_buffer_t *lsp_buffer_alloc(lsp_interface_t *iface, size_t len);
 
+/**
+ * @brief allocates a buffer descriptor for memory owned by a driver. 
+ * release is called on lsp_buffer_free to give the memory back
+ * 
+ * @param iface pointer to interface that owns the memory
+ * @param mem pointer to memory
+ * @param size size of memory in bytes
+ * @param headroom bytes reserved in front of data
+ * @param release function to return mem to the driver
+ * @param arg driver data for release
+ * @return lsp_buffer_t* pointer to buffer on success, otherwise NULL
+ */
+lsp_buffer_t *lsp_buffer_wrap(lsp_interface_t *iface, void *mem, size_t size, size_t headroom,
+                              void (*release)(lsp_buffer_t *buff), void *arg);
+
 /**
  * @brief add data to the buffer
  * 
@@ -25,6 +25,8 @@
 #include "lsp_list.h"
 #include "lsp_queue.h"
 #include "lsp_egroup.h"
+#include "lsp_interface.h"
+#include "lsp_routing.h"
 
 /** LSP Connection types */
 typedef enum lsp_conn_type_e
@@ -95,6 +97,11 @@ struct lsp_conn_s
     uint32_t timestamp;          /** Time the connection was opened */
     lsp_queue_handle_t rx_queue; /** primitive for sync TODO: implement something like event groups or cond var */
     lsp_list_head_t rxstream, txstream;
+    lsp_interface_t *iface;      /** cached route to raddr, valid while route_gen matches rtable */
+    uint32_t route_gen;          /** rtable generation of cached route */
+    uint32_t flowhash;           /** flow hash of connection for path selection */
+    uint32_t acct_count;         /** packets sent through iface not yet accounted to its path */
+    uint64_t acct_bytes;         /** bytes sent through iface not yet accounted to its path */
 };
 
 /**
@@ -104,6 +111,13 @@ struct lsp_conn_s
  */
 int lsp_conn_init();
 
+/**
+ * @brief Frees the connection pool, no connection may be in use
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_conn_pool_free();
+
 /**
  * @brief allocate new connection
  * 
@@ -141,8 +155,53 @@ int lsp_conn_rxq_flush(lsp_conn_t *conn);
  * 
  * @param conn connection
  * @param buffer buffer
- * @return int 
+ * @param timeout time in ms to wait for space in rx_queue, 0 to fail right away if full
+ * @return int LSP_ERR_NONE on success, otherwise an error code
  */
-int lsp_conn_rxq_push(lsp_conn_t *conn, lsp_buffer_t *buffer);
+int lsp_conn_rxq_push(lsp_conn_t *conn, lsp_buffer_t *buffer, uint32_t timeout);
+
+/**
+ * @brief Resolves and caches the route to the remote address of the connection
+ * 
+ * @param conn connection
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_conn_route(lsp_conn_t *conn);
+
+/**
+ * @brief Returns the cached interface to the remote address, 
+ * resolving the route again only if rtable changed since it was cached
+ * 
+ * @param conn connection
+ * @return lsp_interface_t* pointer to interface, NULL if remote address is unreachable
+ */
+static inline lsp_interface_t *lsp_conn_iface(lsp_conn_t *conn)
+{
+    if (conn->route_gen != lsp_routing_generation() && lsp_conn_route(conn) != LSP_ERR_NONE)
+        return NULL;
+    return conn->iface;
+}
+
+/**
+ * @brief Accounts the batched packets of the connection to the path of its cached route
+ * 
+ * @param conn connection
+ */
+void lsp_conn_account_flush(lsp_conn_t *conn);
+
+/**
+ * @brief Accounts a packet sent through the cached interface of the connection,
+ * the path counters are updated once every LSP_DEFAULT_CONN_ACCOUNT_BATCH packets
+ * and whenever the cached route changes
+ * 
+ * @param conn connection
+ * @param len packet length in bytes
+ */
+static inline void lsp_conn_account(lsp_conn_t *conn, size_t len)
+{
+    __atomic_add_fetch(&conn->acct_bytes, len, __ATOMIC_RELAXED);
+    if (__atomic_add_fetch(&conn->acct_count, 1, __ATOMIC_RELAXED) >= LSP_DEFAULT_CONN_ACCOUNT_BATCH)
+        lsp_conn_account_flush(conn);
+}
 
 #endif
\ No newline at end of file
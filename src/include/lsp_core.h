@@ -17,20 +17,84 @@
  *      Cedric Velandres, <ccvelandres@gmail.com>
  */
 
-#ifndef LSP_ROUTING_H
-#define LSP_ROUTING_H
+#ifndef LSP_CORE_H
+#define LSP_CORE_H
 
 #include <stddef.h>
 #include "lsp_types.h"
 #include "lsp_list.h"
+#include "lsp_spin.h"
+
+/** LSP Core events */
+typedef enum lsp_events_e
+{
+    LSP_EV_NO_EVENT = 0,   /** no event, core woke up on timeout */
+    LSP_EV_NET_RX_EVENT,   /** packet received from interface, data is lsp_buffer_t */
+    LSP_EV_NET_TX_EVENT,   /** packets queued for transmission, data is lsp_interface_t */
+    LSP_EV_BARRIER         /** all earlier events were handled, data is lsp_egroup_handle_t to signal */
+} lsp_events_t;
+
+/** LSP Core worker stats for tuning the budget, events / batches is the average batch size */
+typedef struct lsp_core_stats_s
+{
+    uint64_t batches;          /** wakeups that handled at least one event */
+    uint64_t events;           /** total events handled */
+    uint64_t budget_exhausted; /** batches that used all of lsp_conf->core_budget, core did not sleep after them */
+    uint32_t batch_max;        /** largest batch */
+    lsp_spin_stats_t spin;     /** idle waits and their wakeup latency, see lsp_conf->core_spin_us */
+} lsp_core_stats_t;
 
 /**
- * @brief Starts the LSP Core Module
+ * @brief Starts the LSP Core Module with lsp_conf->core_workers workers.
+ * RX packets are steered to a worker by lsp_flow_hash, so a connection is
+ * always processed by the same worker. Mesh and link probes and all timers
+ * are handled by worker 0. With LSP_CORE_POLL no thread is started, the
+ * application runs the single worker with lsp_core_poll
  * 
  * @return int LSP_ERR_NONE on success, otherwise an error code
  */
 int lsp_core_start();
 
+#if (LSP_CORE_POLL)
+/**
+ * @brief Handles up to budget queued events and runs due timers in the calling
+ * thread, never blocks. Every other lsp call must come from the same thread
+ * 
+ * @param budget max events to handle, 0 for lsp_conf->core_budget
+ * @return int number of events handled, negative error code if core is not started
+ */
+int lsp_core_poll(uint8_t budget);
+
+/**
+ * @brief Returns how long the application may wait before calling lsp_core_poll 
+ * again, valid until it sends or receives packets
+ * 
+ * @return uint32_t time in ms, 0 if events are still queued
+ */
+uint32_t lsp_core_poll_timeout();
+#endif
+
+/**
+ * @brief Retrieves the stats of a core worker. Core workers drain up to 
+ * lsp_conf->core_budget events per wakeup and handle them grouped by type
+ * 
+ * @param worker worker index, less than lsp_conf->core_workers
+ * @param stats pointer to stats struct to write
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_core_getstats(uint8_t worker, lsp_core_stats_t *stats);
+
+/**
+ * @brief Decodes, demuxes and delivers a received packet in the calling thread 
+ * (run-to-completion rx). Mesh and link probes are queued to core worker 0.
+ * Never waits for a full socket rx_queue, such packets are dropped and counted in the interface stats
+ * 
+ * @param buff buffer with lsp packet at buff->data and buff->iface set
+ * @return int LSP_ERR_NONE if the buffer was consumed, otherwise an error code and 
+ * the buffer is still owned by the caller
+ */
+int lsp_core_input(lsp_buffer_t *buff);
+
 /**
  * @brief Send an event to the core module
  * 
@@ -40,4 +104,25 @@ int lsp_core_start();
  */
 int lsp_core_sendevent(lsp_events_t ev, void *data);
 
+/**
+ * @brief Send a batch of events of the same type to the core module 
+ * with a single queue operation
+ * 
+ * @param ev event id
+ * @param data array of n data pointers, one per event
+ * @param n number of events (<= LSP_DEFAULT_IF_RX_BURST)
+ * @return int number of events queued, data is reordered so that events
+ * that were not queued are the ones after that
+ */
+int lsp_core_sendevent_burst(lsp_events_t ev, void **data, int n);
+
+/**
+ * @brief Waits until every core worker has handled all events queued before this call.
+ * Must not be called from core task. With LSP_CORE_POLL the queued events are handled
+ * by the caller
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_core_barrier();
+
 #endif
\ No newline at end of file
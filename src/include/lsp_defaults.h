@@ -50,6 +50,10 @@
 #define LSP_DEFAULT_CONN_QUEUELEN 4
 #endif
 
+#ifndef LSP_DEFAULT_CONN_ACCOUNT_BATCH
+#define LSP_DEFAULT_CONN_ACCOUNT_BATCH 32
+#endif
+
 #ifndef LSP_DEFAULT_QUEUE_TIMEOUT_MS
 #define LSP_DEFAULT_QUEUE_TIMEOUT_MS 100
 #endif
@@ -62,20 +66,152 @@
 #define LSP_DEFAULT_ROUTE_EXPIRY_MS 500
 #endif
 
+#ifndef LSP_DEFAULT_ROUTE_MAX_PATHS
+#define LSP_DEFAULT_ROUTE_MAX_PATHS 4
+#endif
+
+#ifndef LSP_DEFAULT_MESH_UPDATE_MS
+#define LSP_DEFAULT_MESH_UPDATE_MS (LSP_DEFAULT_ROUTE_EXPIRY_MS / 3)
+#endif
+
+#ifndef LSP_DEFAULT_MESH_TRIGGER_MS
+#define LSP_DEFAULT_MESH_TRIGGER_MS 20
+#endif
+
+#ifndef LSP_DEFAULT_MESH_COST_REF
+#define LSP_DEFAULT_MESH_COST_REF 10000000
+#endif
+
+#ifndef LSP_DEFAULT_MESH_COST_UNKNOWN
+#define LSP_DEFAULT_MESH_COST_UNKNOWN 100
+#endif
+
+#ifndef LSP_DEFAULT_LINK_EST_MS
+#define LSP_DEFAULT_LINK_EST_MS 100
+#endif
+
+#ifndef LSP_DEFAULT_LINK_EST_MIN_BYTES
+#define LSP_DEFAULT_LINK_EST_MIN_BYTES 4096
+#endif
+
+#ifndef LSP_DEFAULT_LINK_EWMA_SHIFT
+#define LSP_DEFAULT_LINK_EWMA_SHIFT 3
+#endif
+
+#ifndef LSP_DEFAULT_LINK_PROBE_MS
+#define LSP_DEFAULT_LINK_PROBE_MS 1000
+#endif
+
+#ifndef LSP_DEFAULT_IF_MAX
+#define LSP_DEFAULT_IF_MAX 32
+#endif
+
+#ifndef LSP_DEFAULT_IF_TXQUEUE_LEN
+#define LSP_DEFAULT_IF_TXQUEUE_LEN 256
+#endif
+
+#ifndef LSP_DEFAULT_SHM_SLOTS
+#define LSP_DEFAULT_SHM_SLOTS 256
+#endif
+
+#ifndef LSP_DEFAULT_SHM_SLOT_SIZE
+#define LSP_DEFAULT_SHM_SLOT_SIZE 2048
+#endif
+
+#ifndef LSP_DEFAULT_IF_TXQUEUE_TIMEOUT_MS
+#define LSP_DEFAULT_IF_TXQUEUE_TIMEOUT_MS 0
+#endif
+
+#ifndef LSP_DEFAULT_IF_STATS_SHARDS
+#define LSP_DEFAULT_IF_STATS_SHARDS 8
+#endif
+
+#ifndef LSP_DEFAULT_IF_TX_BURST
+#define LSP_DEFAULT_IF_TX_BURST 32
+#endif
+
+#ifndef LSP_DEFAULT_IF_TX_INFLIGHT
+#define LSP_DEFAULT_IF_TX_INFLIGHT 64
+#endif
+
+#ifndef LSP_DEFAULT_IF_TX_WORKERS
+#define LSP_DEFAULT_IF_TX_WORKERS 0
+#endif
+
+#ifndef LSP_DEFAULT_IF_TX_CPUS
+#define LSP_DEFAULT_IF_TX_CPUS 0
+#endif
+
+#ifndef LSP_DEFAULT_IF_RX_BURST
+#define LSP_DEFAULT_IF_RX_BURST 32
+#endif
+
+/** Runs the core from lsp_core_poll in the application's loop instead of core threads.
+ * Queues and event groups never block, every lsp call must come from that loop */
+#ifndef LSP_CORE_POLL
+#define LSP_CORE_POLL 0
+#endif
+
 #ifndef LSP_DEFAULT_CORE_STACK_SIZE
+#if (LSP_POSIX)
+#define LSP_DEFAULT_CORE_STACK_SIZE (64 * 1024)
+#else
 #define LSP_DEFAULT_CORE_STACK_SIZE 2048
 #endif
+#endif
 
 #ifndef LSP_DEFAULT_CORE_PRIORITY
 #define LSP_DEFAULT_CORE_PRIORITY 7
 #endif
 
-#ifndef LSP_DEFAULT_CORE_STACK_SIZE
-#define LSP_DEFAULT_CORE_STACK_SIZE 2048
+/** thread priorities range from 0 to LSP_DEFAULT_THREAD_PRIORITY_MAX */
+#ifndef LSP_DEFAULT_THREAD_PRIORITY_MAX
+#define LSP_DEFAULT_THREAD_PRIORITY_MAX 7
+#endif
+
+/** posix scheduling of lsp threads, 0 time sharing ignores priority, 1 SCHED_FIFO, 2 SCHED_RR */
+#ifndef LSP_DEFAULT_THREAD_SCHED
+#define LSP_DEFAULT_THREAD_SCHED 0
+#endif
+
+#ifndef LSP_DEFAULT_CORE_MAX_SLEEP_MS
+#define LSP_DEFAULT_CORE_MAX_SLEEP_MS 500
 #endif
 
 #ifndef LSP_DEFAULT_CORE_EVQUEUE_LEN
 #define LSP_DEFAULT_CORE_EVQUEUE_LEN 32
 #endif
 
+#ifndef LSP_DEFAULT_CORE_WORKERS
+#define LSP_DEFAULT_CORE_WORKERS 1
+#endif
+
+#ifndef LSP_DEFAULT_CORE_WORKERS_MAX
+#define LSP_DEFAULT_CORE_WORKERS_MAX 8
+#endif
+
+#ifndef LSP_DEFAULT_CORE_CPUS
+#define LSP_DEFAULT_CORE_CPUS 0
+#endif
+
+#ifndef LSP_DEFAULT_CORE_BUDGET
+#define LSP_DEFAULT_CORE_BUDGET 32
+#endif
+
+#ifndef LSP_DEFAULT_CORE_BUDGET_MAX
+#define LSP_DEFAULT_CORE_BUDGET_MAX 128
+#endif
+
+#ifndef LSP_DEFAULT_CORE_SPIN_US
+#define LSP_DEFAULT_CORE_SPIN_US 0
+#endif
+
+#ifndef LSP_DEFAULT_TIMER_WHEEL_BITS
+#define LSP_DEFAULT_TIMER_WHEEL_BITS 6
+#endif
+
+#ifndef LSP_DEFAULT_TIMER_WHEEL_LEVELS
+#define LSP_DEFAULT_TIMER_WHEEL_LEVELS 4
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_EVQ_H
+#define LSP_EVQ_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_spin.h"
+
+/** LSP Event queue entry */
+typedef struct lsp_evq_entry_s
+{
+    uint32_t ev;    /** event id */
+    uint32_t stamp; /** push time in us, set by lsp_evq_push_burst */
+    void *data;     /** event data */
+} lsp_evq_entry_t;
+
+/** Forward declaration for event queue structure */
+typedef struct lsp_evq_s lsp_evq_t;
+
+/**
+ * @brief Creates a bounded lock-free multi-producer single-consumer event queue.
+ * Producers never block, the consumer only sleeps while the queue is empty
+ * 
+ * @param len queue length, rounded up to a power of 2
+ * @return lsp_evq_t* pointer to queue, NULL on failure
+ */
+lsp_evq_t *lsp_evq_create(uint32_t len);
+
+/**
+ * @brief Destroys a queue, entries still queued are dropped
+ * 
+ * @param evq pointer to queue
+ */
+void lsp_evq_destroy(lsp_evq_t *evq);
+
+/**
+ * @brief Pushes up to n entries with a single reservation and at most one
+ * consumer wakeup. May be called from any thread
+ * 
+ * @param evq pointer to queue
+ * @param entries array of n entries
+ * @param n number of entries
+ * @return int number of entries pushed, entries after that did not fit in queue
+ */
+int lsp_evq_push_burst(lsp_evq_t *evq, const lsp_evq_entry_t *entries, int n);
+
+/**
+ * @brief Pushes one entry. May be called from any thread
+ * 
+ * @param evq pointer to queue
+ * @param ev event id
+ * @param data event data
+ * @return int LSP_ERR_NONE on success, LSP_ERR_QUEUE_FULL if the queue is full
+ */
+static inline int lsp_evq_push(lsp_evq_t *evq, uint32_t ev, void *data)
+{
+    lsp_evq_entry_t entry = {
+        .ev = ev,
+        .data = data
+    };
+    return lsp_evq_push_burst(evq, &entry, 1) == 1 ? LSP_ERR_NONE : LSP_ERR_QUEUE_FULL;
+}
+
+/**
+ * @brief Pops up to n entries with a single head update, waits up to timeout 
+ * if the queue is empty. Must only be called by the single consumer
+ * 
+ * @param evq pointer to queue
+ * @param entries array of at least n entries
+ * @param n max number of entries to pop
+ * @param timeout timeout in ms, LSP_TIMEOUT_MAX to wait forever
+ * @return int number of entries popped, 0 if the queue stayed empty
+ */
+int lsp_evq_pop_burst(lsp_evq_t *evq, lsp_evq_entry_t *entries, int n, uint32_t timeout);
+
+/**
+ * @brief Sets how long the consumer may spin on an empty queue before it blocks.
+ * The actual spin adapts to recent waits and stays within the budget
+ * 
+ * @param evq pointer to queue
+ * @param spin_us spin budget in us, 0 to always block
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_evq_set_spin(lsp_evq_t *evq, uint32_t spin_us);
+
+/**
+ * @brief Copies the consumer wait statistics of a queue
+ * 
+ * @param evq pointer to queue
+ * @param stats reference to stats
+ */
+void lsp_evq_getspin(lsp_evq_t *evq, lsp_spin_stats_t *stats);
+
+/**
+ * @brief Pops one entry, waits up to timeout if the queue is empty. 
+ * Must only be called by the single consumer
+ * 
+ * @param evq pointer to queue
+ * @param entry popped entry
+ * @param timeout timeout in ms, LSP_TIMEOUT_MAX to wait forever
+ * @return int LSP_ERR_NONE on success, LSP_ERR_TIMEOUT if the queue stayed empty
+ */
+static inline int lsp_evq_pop(lsp_evq_t *evq, lsp_evq_entry_t *entry, uint32_t timeout)
+{
+    return lsp_evq_pop_burst(evq, entry, 1, timeout) == 1 ? LSP_ERR_NONE : LSP_ERR_TIMEOUT;
+}
+
+#endif
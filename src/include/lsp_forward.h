@@ -0,0 +1,44 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_FORWARD_H
+#define LSP_FORWARD_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+
+/** Enables relaying of packets not addressed to this node (LSP_SP_FORWARDING service) */
+#ifndef LSP_FORWARDING_ENABLED
+#define LSP_FORWARDING_ENABLED 1
+#endif
+
+#if (LSP_FORWARDING_ENABLED)
+/**
+ * @brief Forwards a received packet not addressed to this node to the egress interface.
+ * Only the iface and link-layer headroom of the buffer are changed, the lsp packet is left untouched.
+ * Packets routed back out of their ingress link are dropped. Buffer is consumed
+ * 
+ * @param buff buffer with lsp_packet set
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_forward(lsp_buffer_t *buff);
+#endif
+
+#endif
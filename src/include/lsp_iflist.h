@@ -28,7 +28,22 @@
 #include "lsp_types.h"
 
 /**
- * @brief registers the interface to iflist. Must only be called before starting the service, may cause UD when called while service is running
+ * @brief Initializes the interface list. Called by lsp_init
+ * 
+ * @return int #LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_iflist_init();
+
+/**
+ * @brief Frees the interface list, all interfaces must be unregistered
+ * 
+ * @return int #LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_iflist_free();
+
+/**
+ * @brief adds the interface to iflist and assigns its index. 
+ * Safe while the service is running, readers see the interface once this returns
  * 
  * @param iface pointer to interface struct
  * @return int #LSP_ERR_NONE on success, otherwise an error code
@@ -36,7 +51,36 @@
 int lsp_iflist_add(lsp_interface_t *iface);
 
 /**
- * @brief search for an interface with matching iface name
+ * @brief removes the interface from iflist. Readers that found the interface before
+ * may still use it until lsp_iflist_synchronize returns
+ * 
+ * @param iface pointer to interface struct
+ * @return int #LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_iflist_del(lsp_interface_t *iface);
+
+/**
+ * @brief starts a read-side critical section. Interfaces found through iflist
+ * stay valid until the matching lsp_iflist_read_unlock. Sections may nest
+ * 
+ */
+void lsp_iflist_read_lock();
+
+/**
+ * @brief ends a read-side critical section
+ * 
+ */
+void lsp_iflist_read_unlock();
+
+/**
+ * @brief waits until every read-side critical section that started before this call has ended.
+ * Must not be called within a read-side critical section
+ * 
+ */
+void lsp_iflist_synchronize();
+
+/**
+ * @brief search for an interface with matching iface name. Call within a read-side critical section
  * 
  * @param name name to match
  * @return lsp_interface_t* pointer to interface on success, otherwise NULL
@@ -44,11 +88,28 @@ int lsp_iflist_add(lsp_interface_t *iface);
 lsp_interface_t *lsp_iflist_iface_byname(const char *name);
 
 /**
- * @brief search for an interface with matching address
+ * @brief search for an interface with matching address. Call within a read-side critical section
  * 
  * @param addr address to match
  * @return lsp_interface_t* pointer to interface on success, otherwise NULL
  */
 lsp_interface_t *lsp_iflist_iface_byaddr(const lsp_addr_t addr);
 
-#endif
\ No newline at end of file
+/**
+ * @brief search for an interface by index. Call within a read-side critical section
+ * 
+ * @param index interface index
+ * @return lsp_interface_t* pointer to interface on success, otherwise NULL
+ */
+lsp_interface_t *lsp_iflist_iface_byindex(int index);
+
+/**
+ * @brief iterate through registered interfaces. Call within a read-side critical section or from core task,
+ * interfaces removed during iteration are still returned
+ * 
+ * @param iface current interface, NULL to get the first interface
+ * @return lsp_interface_t* pointer to next interface, NULL if iface is the last
+ */
+lsp_interface_t *lsp_iflist_next(lsp_interface_t *iface);
+
+#endif
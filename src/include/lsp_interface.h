@@ -29,26 +29,77 @@
 /** Forward declaration for lsp_interface_s */
 typedef struct lsp_interface_s lsp_interface_t;
 
+/** Forward declaration for tx worker of an interface */
+typedef struct lsp_interface_txworker_s lsp_interface_txworker_t;
+
 /** LSP Interface operation functions*/
 typedef struct lsp_interface_ops
 {
     int (*open)(lsp_interface_t *pv);                       /** called by system to initialize interface */
     int (*close)(lsp_interface_t *pv);                      /** called by system during shutdown */
     int (*tx)(lsp_interface_t *pv, void *data, size_t len); /** used by system to transmit packets */
+    int (*tx_burst)(lsp_interface_t *pv, lsp_buffer_t **bufs, int n); /** optional, transmit bufs in order, returns number of packets sent (or accepted, see LSP_IF_FLAGS_TX_ASYNC) */
+    lsp_buffer_t *(*alloc)(lsp_interface_t *pv, size_t len); /** optional, allocates buffers from driver memory, NULL falls back to heap */
 } lsp_interface_ops_t;
 
+/**
+   @defgroup LSP_IF_FLAGS LSP Interface flags
+   @{
+*/
+#define LSP_IF_FLAGS_ZERO_COPY (1 << 0) /** driver passes packets to its peer without copying payload */
+#define LSP_IF_FLAGS_TX_ASYNC (1 << 2)  /** driver keeps buffers accepted by tx_burst and returns them with lsp_interface_tx_complete */
+#define LSP_IF_FLAGS_RX_INLINE (1 << 3) /** received packets are demuxed and delivered in the driver's rx thread, see lsp_interface_set_rx_inline */
+/**@}*/
+
+/** Number of bins in burst histograms, bin i counts bursts of 2^i to 2^(i+1)-1 packets */
+#define LSP_IF_BURST_HIST_BINS 6
+
+/** Number of priority levels counted in stats, one per connection priority */
+#define LSP_IF_STATS_PRIOS (LSP_CONN_PRIO_MAX + 1)
+
 /** LSP Interface stats for monitoring*/
 typedef struct lsp_interface_stats
 {
-    uint32_t tx_count; /** total transmitted packet count */
-    uint32_t rx_count; /** total received packet count */
-    uint32_t tx_bytes; /** total transmitted byte count */
-    uint32_t rx_bytes; /** total received byte count */
-    uint32_t dropped;  /** total dropped packet count */
-    uint32_t tx_error; /** total transmit errors */
-    uint32_t rx_error; /** total receive errors */
+    uint64_t tx_count;    /** total transmitted packet count */
+    uint64_t rx_count;    /** total received packet count */
+    uint64_t tx_bytes;    /** total transmitted byte count */
+    uint64_t rx_bytes;    /** total received byte count */
+    uint64_t dropped;     /** total dropped packet count */
+    uint64_t tx_error;    /** total transmit errors */
+    uint64_t rx_error;    /** total receive errors */
+    uint64_t forwarded;   /** total packets forwarded to this interface */
+    uint64_t fwd_dropped; /** total packets received on this interface that could not be forwarded */
+    uint64_t txq_full;    /** packets dropped because tx_queue was full (included in dropped) */
+    uint64_t evq_full;    /** received packets dropped because core evqueue was full (included in dropped) */
+    uint64_t rx_inline;   /** received packets delivered in the driver's rx thread (LSP_IF_FLAGS_RX_INLINE) */
+    uint64_t tx_inflight_full; /** drains stopped because tx_inflight_max buffers were still owned by the driver */
+    uint64_t tx_burst_hist[LSP_IF_BURST_HIST_BINS]; /** histogram of packets handed to the driver per tx burst */
+    uint64_t rx_burst_hist[LSP_IF_BURST_HIST_BINS]; /** histogram of packets delivered by the driver per rx burst */
+    uint64_t tx_prio_bytes[LSP_IF_STATS_PRIOS];     /** transmitted byte count per buffer priority */
 } lsp_interface_stats_t;
 
+/** LSP Interface link estimate, maintained by lsp_link */
+typedef struct lsp_link_est_s
+{
+    uint32_t linkspeed;  /** EWMA of measured throughput in bytes/s, 0 until measured */
+    uint32_t rtt_us;     /** EWMA of probe round trip time in us, 0 until measured */
+    uint32_t reported;   /** linkspeed last applied to routes */
+    uint32_t busy_us;    /** time spent in driver tx since the last estimate */
+    uint64_t busy_bytes; /** bytes sent within busy_us */
+    uint32_t last_complete; /** time in us of the last asynchronous tx completion */
+} lsp_link_est_t;
+
+/** 
+ * LSP Interface stats shard. Each thread writes to its own shard without atomics, 
+ * readers sum all shards. seq is odd while the owner is writing
+ */
+typedef struct lsp_interface_shard_s
+{
+    uint32_t seq;                /** write sequence */
+    uint32_t lock;               /** only used on the last shard, which is shared by overflow threads */
+    lsp_interface_stats_t stats; /** counters of this shard */
+} __attribute__((aligned(64))) lsp_interface_shard_t;
+
 /** LSP Interface main structure */
 struct lsp_interface_s
 {
@@ -58,13 +109,105 @@ struct lsp_interface_s
     int flags;                   /** interface flags. see #LSP_IF_FLAGS */
     uint32_t mtu;                /** max transmission unit of interface */
     lsp_interface_ops_t *ops;    /** interface functions */
-    lsp_interface_stats_t stats; /** interface stats */
+    lsp_interface_shard_t stats[LSP_DEFAULT_IF_STATS_SHARDS]; /** interface stats, use lsp_interface_stats_begin/snapshot */
     int min_header_len;          /** minimum header len to allocate in front of lsp packet for encapsulation */
     lsp_list_t list;             /** interface is implemented as linked list*/
+    lsp_interface_t *name_next;  /** next interface in iflist name hash bucket */
+    int removed;                 /** set on unregister, packets to and from the interface are dropped */
     lsp_queue_handle_t tx_queue; /** interface tx queue */
+    int tx_pending;              /** set while a tx event for this interface is queued to core */
+    int tx_inflight;             /** buffers owned by an asynchronous driver (LSP_IF_FLAGS_TX_ASYNC) */
+    int tx_inflight_max;         /** tx_queue is not drained while tx_inflight reaches this limit */
+    int tx_blocked;              /** set while drain waits for tx completions */
+    int tx_draining;             /** set while a thread is calling the driver */
+    int tx_drain_missed;         /** a drain was refused while tx_draining was set */
+    int rx_loans;                /** received buffers wrapping driver memory that the stack did not free yet */
+    lsp_interface_txworker_t *tx_worker; /** tx worker draining tx_queue, NULL if drained by core */
+    lsp_link_est_t link;         /** measured throughput and latency, see lsp_link_getest */
     void *interface_data;        /** interface data, used by driver (retrieve with interface_getdata()) */
 };
 
+/** stats shard of the calling thread, -1 until first use */
+extern __thread int lsp_interface_shard_id;
+
+/**
+ * @brief sets up the stats shards, shards are given back when their threads exit
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_shards_init();
+
+/**
+ * @brief releases what lsp_interface_shards_init set up
+ */
+void lsp_interface_shards_free();
+
+/**
+ * @brief assigns a free stats shard to the calling thread until it exits,
+ * threads that find no free shard share the last one
+ * 
+ * @return int shard index
+ */
+int lsp_interface_shard_init();
+
+/**
+ * @brief starts an update of the calling thread's stats shard. 
+ * Counters of the returned stats are updated with plain arithmetic until lsp_interface_stats_end
+ * 
+ * @param iface pointer to interface
+ * @return lsp_interface_stats_t* counters to update
+ */
+static inline lsp_interface_stats_t *lsp_interface_stats_begin(lsp_interface_t *iface)
+{
+    int id = lsp_interface_shard_id >= 0 ? lsp_interface_shard_id : lsp_interface_shard_init();
+    lsp_interface_shard_t *shard = &iface->stats[id];
+
+    if (id == LSP_DEFAULT_IF_STATS_SHARDS - 1)
+    {
+        while (__atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE))
+            ;
+    }
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return &shard->stats;
+}
+
+/**
+ * @brief ends an update started with lsp_interface_stats_begin
+ * 
+ * @param iface pointer to interface
+ * @param stats counters returned by lsp_interface_stats_begin
+ */
+static inline void lsp_interface_stats_end(lsp_interface_t *iface, lsp_interface_stats_t *stats)
+{
+    lsp_interface_shard_t *shard = container_of(stats, lsp_interface_shard_t, stats);
+
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+    if (shard == &iface->stats[LSP_DEFAULT_IF_STATS_SHARDS - 1])
+        __atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+}
+
+/** adds n to a single interface counter */
+#define LSP_IF_STATS_ADD(iface, field, n)                              \
+    do                                                                 \
+    {                                                                  \
+        lsp_interface_stats_t *_st = lsp_interface_stats_begin(iface); \
+        _st->field += (n);                                             \
+        lsp_interface_stats_end(iface, _st);                           \
+    } while (0)
+
+/** increments a single interface counter */
+#define LSP_IF_STATS_INC(iface, field) LSP_IF_STATS_ADD(iface, field, 1)
+
+/**
+ * @brief sums the stats shards of the interface. 
+ * Each shard is copied consistently, counters updated together in one shard are never torn
+ * 
+ * @param iface pointer to interface
+ * @param stats pointer to store the sum
+ */
+void lsp_interface_stats_snapshot(lsp_interface_t *iface, lsp_interface_stats_t *stats);
+
 /**
  * @brief allocates memory for lsp_interface and initializes the queue
  * 
@@ -78,6 +221,34 @@ lsp_interface_t *lsp_interface_alloc(int tx_queuelen,
                                      size_t priv_len,
                                      const char *fmt, ...);
 
+/**
+ * @brief frees an interface allocated with lsp_interface_alloc. 
+ * Interface must not be registered
+ * 
+ * @param iface pointer to interface
+ */
+void lsp_interface_free(lsp_interface_t *iface);
+
+/**
+ * @brief assigns the interface index and address, opens the interface 
+ * and adds it to iflist. Must be called after lsp_init
+ * 
+ * @param iface pointer to interface with ops set
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_register(lsp_interface_t *iface);
+
+/**
+ * @brief removes a registered interface while the service is running. Routes through the interface
+ * are removed, the driver is closed and the interface is freed once no thread uses it anymore.
+ * Blocks until asynchronous drivers completed all buffers and received buffers lent by the driver
+ * were freed. Must not be called from core task
+ * 
+ * @param iface pointer to registered interface
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_unregister(lsp_interface_t *iface);
+
 /**
  * @brief Returns a pointer to interface data that can be used by interface drivers
  * 
@@ -99,4 +270,121 @@ void *lsp_interface_getdata(lsp_interface_t *iface);
  */
 int lsp_interface_qwrite(lsp_interface_t *iface, void *data, size_t len, int flags);
 
+/**
+ * @brief delivers a batch of received buffers to the core with a single queue operation,
+ * or handles them in the calling thread with LSP_IF_FLAGS_RX_INLINE.
+ * Buffers are owned by the system after this call, buffers that could not be queued are
+ * freed and counted as dropped
+ * 
+ * @param iface pointer to source interface
+ * @param bufs array of buffers with lsp packet at buff->data
+ * @param n number of buffers
+ * @return int number of buffers accepted, n - accepted were dropped
+ */
+int lsp_interface_rx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n);
+
+/**
+ * @brief selects run-to-completion rx. When enabled, lsp_interface_rx_burst decodes, demuxes 
+ * and delivers packets to socket rx queues in the calling driver thread instead of queuing 
+ * them to core. Mesh and link probes still go through core. May be changed at any time
+ * 
+ * @param iface pointer to interface
+ * @param enable 1 to handle rx in the driver thread, 0 to queue rx to core
+ */
+void lsp_interface_set_rx_inline(lsp_interface_t *iface, int enable);
+
+/**
+ * @brief queues a buffer for transmission on the interface.
+ * Buffer is owned by the interface tx path after this call, even on error
+ * 
+ * @param iface pointer to interface
+ * @param buff buffer with lsp packet at buff->data
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_xmit(lsp_interface_t *iface, lsp_buffer_t *buff);
+
+/**
+ * @brief queues a buffer for transmission on the interface like lsp_interface_xmit,
+ * waiting at most timeout for space in tx_queue
+ * 
+ * @param iface pointer to interface
+ * @param buff buffer with lsp packet at buff->data
+ * @param timeout time in ms to wait for space in tx_queue, 0 to drop right away if full
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_xmit_timeout(lsp_interface_t *iface, lsp_buffer_t *buff, uint32_t timeout);
+
+/**
+ * @brief starts a dedicated thread that drains tx_queue and calls the driver instead of core,
+ * so a slow driver does not delay other interfaces
+ * 
+ * @param iface pointer to registered interface
+ * @param cpus cpus to pin the worker to, 0 for any cpu
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_interface_txworker_start(lsp_interface_t *iface, lsp_cpumask_t cpus);
+
+/**
+ * @brief stops the tx worker of an interface, tx_queue is drained by core again.
+ * Packets must not be transmitted on iface while the worker stops
+ * 
+ * @param iface pointer to interface
+ */
+void lsp_interface_txworker_stop(lsp_interface_t *iface);
+
+/**
+ * @brief returns buffers accepted by an asynchronous driver (LSP_IF_FLAGS_TX_ASYNC) to the system
+ * once the hardware or peer is done with them. Buffers are freed, in-flight space is released
+ * and draining resumes if it was stopped at tx_inflight_max. May be called from any thread
+ * 
+ * @param iface pointer to interface
+ * @param bufs buffers previously accepted by ops->tx_burst, oldest first
+ * @param n number of buffers, nothing is done if 0 or less
+ */
+void lsp_interface_tx_complete(lsp_interface_t *iface, lsp_buffer_t **bufs, int n);
+
+/**
+ * @brief counts a received buffer that wraps driver memory, unregister waits until
+ * every loan was returned with lsp_interface_rx_return before freeing iface
+ * 
+ * @param iface pointer to interface
+ */
+static inline void lsp_interface_rx_lend(lsp_interface_t *iface)
+{
+    __atomic_add_fetch(&iface->rx_loans, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief returns a loan counted with lsp_interface_rx_lend. Must be the driver's last
+ * access to iface and its data from the release callback
+ * 
+ * @param iface pointer to interface
+ */
+static inline void lsp_interface_rx_return(lsp_interface_t *iface)
+{
+    __atomic_sub_fetch(&iface->rx_loans, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief returns the histogram bin of a burst size
+ * 
+ * @param n number of packets in burst (> 0)
+ * @return int bin index
+ */
+static inline int lsp_interface_burst_bin(int n)
+{
+    int bin = 31 - __builtin_clz(n);
+    return bin < LSP_IF_BURST_HIST_BINS ? bin : LSP_IF_BURST_HIST_BINS - 1;
+}
+
+/**
+ * @brief transmits queued buffers through the interface driver in bursts of
+ * up to LSP_DEFAULT_IF_TX_BURST. Uses ops->tx_burst if available, otherwise ops->tx per packet.
+ * Called by core, hands over to the tx worker if the interface has one
+ * 
+ * @param iface pointer to interface
+ * @return int number of packets transmitted
+ */
+int lsp_interface_txq_drain(lsp_interface_t *iface);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_LINK_H
+#define LSP_LINK_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_interface.h"
+
+/** Enables measurement of per-interface throughput and latency, estimates are applied to route linkspeed */
+#ifndef LSP_LINK_EST_ENABLED
+#define LSP_LINK_EST_ENABLED 1
+#endif
+
+#if (LSP_LINK_EST_ENABLED)
+
+/** LSP Link probe types */
+typedef enum lsp_link_probe_type_e
+{
+    LINK_PROBE_REQUEST = 1, /** echo request, answered on the receiving interface */
+    LINK_PROBE_REPLY = 2    /** echo reply carrying the timestamp of the request */
+} lsp_link_probe_type_t;
+
+/** LSP Link probe, sent on LSP_SP_PING */
+typedef struct __attribute__((packed)) lsp_link_probe_s
+{
+    uint8_t type;       /** probe type, see lsp_link_probe_type_t */
+    uint8_t reserved;   /** reserved, set to 0 */
+    uint32_t timestamp; /** sender time in us, echoed back unchanged */
+} lsp_link_probe_t;
+
+/**
+ * @brief accounts a driver transmission for throughput estimation. Called from the tx path
+ * 
+ * @param iface pointer to interface
+ * @param bytes bytes sent by the driver
+ * @param us time spent in the driver in us
+ */
+static inline void lsp_link_tx_sample(lsp_interface_t *iface, size_t bytes, uint32_t us)
+{
+    __atomic_fetch_add(&iface->link.busy_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&iface->link.busy_us, us, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Arms the timers that update link estimates every LSP_DEFAULT_LINK_EST_MS 
+ * and send probes every LSP_DEFAULT_LINK_PROBE_MS. Called by lsp_init
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_link_start();
+
+/**
+ * @brief Processes a link probe received on LSP_SP_PING.
+ * Buffer is consumed
+ * 
+ * @param buff buffer with lsp_packet set
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_link_input(lsp_buffer_t *buff);
+
+/**
+ * @brief Retrieves the link estimate of an interface
+ * 
+ * @param iface pointer to interface
+ * @param est pointer to estimate to write
+ */
+void lsp_link_getest(lsp_interface_t *iface, lsp_link_est_t *est);
+
+#endif
+
+#endif
@@ -118,12 +118,24 @@ static inline void lsp_list_del(lsp_list_t *n)
     n->prev->next = n->next;
 }
 
+/**
+ * @brief moves node to back of list
+ * 
+ * @param n pointer to node to move
+ * @param head pointer to head
+ */
+static inline void lsp_list_move_tail(lsp_list_t *n, lsp_list_head_t *head)
+{
+    lsp_list_del(n);
+    lsp_list_add_tail(n, head);
+}
+
 /**
  * @brief checks whether the list is empty
  * 
  */
 #define lsp_list_is_empty(head) \
-    ((head)->next == (head)->prev ? 1 : 0)
+    ((head)->next == (head) ? 1 : 0)
 
 /**
  * @brief iterate through the list
@@ -133,7 +145,7 @@ static inline void lsp_list_del(lsp_list_t *n)
  * @param head ptr to list_head
  */
 #define lsp_list_for(ptr, member, head)                                                                    \
-    for (ptr = ((head)->next != (head)->prev ? container_of((head)->next, typeof(*(ptr)), member) : NULL); \
+    for (ptr = ((head)->next != (head) ? container_of((head)->next, typeof(*(ptr)), member) : NULL);       \
          ptr;                                                                                              \
          ptr = ((ptr)->member.next != (head) ? container_of((ptr)->member.next, typeof(*(ptr)), member) : NULL))
 // for(ptr = (head)->next; ptr != head; ptr = ptr->next)
@@ -146,7 +158,7 @@ static inline void lsp_list_del(lsp_list_t *n)
  * @param head ptr to list_head
  */
 #define lsp_list_for_back(ptr, member, head)                                                               \
-    for (ptr = ((head)->next != (head)->prev ? container_of((head)->prev, typeof(*(ptr)), member) : NULL); \
+    for (ptr = ((head)->prev != (head) ? container_of((head)->prev, typeof(*(ptr)), member) : NULL);       \
          ptr;                                                                                              \
          ptr = ((ptr)->member.prev != (head) ? container_of((ptr)->member.prev, typeof(*(ptr)), member) : NULL))
 
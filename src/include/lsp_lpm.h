@@ -0,0 +1,103 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_LPM_H
+#define LSP_LPM_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+
+/** LSP LPM table entry */
+typedef struct lsp_lpm_entry_s
+{
+    void *data;    /** data of longest prefix covering this entry */
+    uint8_t depth; /** prefix length + 1 of data, 0 if empty */
+} lsp_lpm_entry_t;
+
+/**
+ * LSP Longest prefix match table for 16-bit addresses (DIR-8-8).
+ * The upper byte indexes hi, prefixes longer than 8 bits are expanded into
+ * a 256 entry group for their upper byte. Lookups take at most two reads.
+ */
+typedef struct lsp_lpm_s
+{
+    lsp_lpm_entry_t hi[256];         /** entries for prefixes up to /8 */
+    lsp_lpm_entry_t *groups[256];    /** expanded entries for prefixes longer than /8 */
+} lsp_lpm_t;
+
+/**
+ * @brief Returns the mask of a prefix length
+ * 
+ * @param len prefix length in bits (0-16)
+ * @return lsp_addr_t network mask
+ */
+static inline lsp_addr_t lsp_lpm_mask(uint8_t len)
+{
+    return (lsp_addr_t)(0xFFFF0000UL >> len);
+}
+
+/**
+ * @brief Looks up the data of the longest prefix matching addr
+ * 
+ * @param lpm pointer to lpm table
+ * @param addr address
+ * @return void* data of matching prefix, NULL if no prefix matches
+ */
+static inline void *lsp_lpm_lookup(lsp_lpm_t *lpm, lsp_addr_t addr)
+{
+    lsp_lpm_entry_t *group = lpm->groups[addr >> 8];
+    if (group != NULL)
+        return group[addr & 0xFF].data;
+    return lpm->hi[addr >> 8].data;
+}
+
+/**
+ * @brief Inserts a prefix to the table
+ * 
+ * @param lpm pointer to lpm table
+ * @param addr prefix address
+ * @param len prefix length in bits (0-16)
+ * @param data data returned on lookup, must not be NULL
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_lpm_insert(lsp_lpm_t *lpm, lsp_addr_t addr, uint8_t len, void *data);
+
+/**
+ * @brief Removes a prefix from the table, 
+ * entries are replaced with the next longest prefix covering the removed one.
+ * A group is freed once no prefix longer than /8 is left in it, so lookups must not run concurrently
+ * 
+ * @param lpm pointer to lpm table
+ * @param addr prefix address
+ * @param len prefix length in bits (0-16)
+ * @param data data of the prefix being removed
+ * @param parent data of the covering prefix, NULL if none
+ * @param parent_len prefix length of the covering prefix
+ */
+void lsp_lpm_delete(lsp_lpm_t *lpm, lsp_addr_t addr, uint8_t len, void *data, void *parent, uint8_t parent_len);
+
+/**
+ * @brief Frees the expanded groups of the table
+ * 
+ * @param lpm pointer to lpm table
+ */
+void lsp_lpm_free(lsp_lpm_t *lpm);
+
+#endif
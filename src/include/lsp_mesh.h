@@ -0,0 +1,88 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_MESH_H
+#define LSP_MESH_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_routing.h"
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+
+/** LSP Mesh advertisement types */
+typedef enum lsp_mesh_type_e
+{
+    MESH_UPDATE_FULL = 1,     /** periodic advertisement of the whole rtable */
+    MESH_UPDATE_TRIGGERED = 2 /** advertisement of changed routes only */
+} lsp_mesh_type_t;
+
+/** LSP Mesh advertisement header, sent on LSP_SP_SYS */
+typedef struct __attribute__((packed)) lsp_mesh_hdr_s
+{
+    uint8_t type;  /** advertisement type, see lsp_mesh_type_t */
+    uint8_t count; /** number of entries following the header */
+} lsp_mesh_hdr_t;
+
+/** LSP Mesh advertisement entry */
+typedef struct __attribute__((packed)) lsp_mesh_entry_s
+{
+    lsp_addr_t addr; /** reachable address */
+    uint16_t cost;   /** cost from advertising node to addr */
+} lsp_mesh_entry_t;
+
+/** LSP Mesh stats for monitoring */
+typedef struct lsp_mesh_stats_s
+{
+    uint32_t updates_tx;   /** total full advertisements sent */
+    uint32_t triggered_tx; /** total triggered advertisements sent */
+    uint32_t updates_rx;   /** total advertisements received */
+    uint32_t entries_rx;   /** total advertised entries received */
+    uint32_t rx_error;     /** total malformed advertisements */
+    uint32_t last_change;  /** time in ms of last rtable change (for measuring convergence) */
+} lsp_mesh_stats_t;
+
+/**
+ * @brief Processes a mesh advertisement received on LSP_SP_SYS.
+ * Buffer is consumed
+ * 
+ * @param buff buffer with lsp_packet set
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_mesh_input(lsp_buffer_t *buff);
+
+/**
+ * @brief Sends periodic and triggered advertisements when due. Called from core task
+ * 
+ * @param now current time in ms
+ * @return uint32_t time in ms until next advertisement is due
+ */
+uint32_t lsp_mesh_tick(uint32_t now);
+
+/**
+ * @brief Retrieves the mesh stats
+ * 
+ * @param stats pointer to stats struct to write
+ */
+void lsp_mesh_getstats(lsp_mesh_stats_t *stats);
+
+#endif
+
+#endif
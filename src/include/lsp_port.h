@@ -62,4 +62,14 @@ int lsp_port_free();
  */
 lsp_port_t *lsp_port_get(uint8_t port);
 
+/**
+ * @brief Delivers a received packet to the socket listening on its destination port.
+ * Buffer is consumed (queued to socket or freed)
+ * 
+ * @param buff buffer with lsp_packet set
+ * @param timeout time in ms to wait for space in the socket rx_queue, 0 to drop right away if full
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_port_input(lsp_buffer_t *buff, uint32_t timeout);
+
 #endif
\ No newline at end of file
@@ -25,22 +25,82 @@
 #include "lsp_interface.h"
 #include "lsp_list.h"
 
-/** TODO: Add support for hops/mesh */
-#define LSP_ROUTING_HOPS_ENABLED 0
+/** Enables multi-hop routing, routes are learned through lsp_mesh */
+#ifndef LSP_ROUTING_HOPS_ENABLED
+#define LSP_ROUTING_HOPS_ENABLED 1
+#endif
+
+/** Route cost for unreachable addresses */
+#define LSP_ROUTE_COST_INFINITY 0xFFFF
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+/** LSP Route next hop */
+typedef struct lsp_hop_s
+{
+    lsp_addr_t next_hop; /** address of neighbor to forward to, same as addr for direct routes */
+    uint16_t cost;       /** cumulative cost to addr, see lsp_route_linkcost */
+} lsp_hop_t;
+#endif
+
+/** LSP Route states */
+typedef enum lsp_route_state_e
+{
+    ROUTE_ACTIVE,  /** route was discovered/refreshed within expiry time */
+    ROUTE_STALE    /** route was not refreshed, replaced by any new route and removed on next expiry */
+}lsp_route_state_t;
+
+/** LSP Route aging events */
+typedef enum lsp_route_event_e
+{
+    ROUTE_EV_DEMOTED,  /** route went stale */
+    ROUTE_EV_EXPIRED   /** route is about to be removed from rtable */
+}lsp_route_event_t;
+
+/** LSP Route path through a single interface */
+typedef struct lsp_route_path_s
+{
+    lsp_interface_t *iface; /** interface of path */
+    uint32_t linkspeed;     /** linkspeed of path in bytes/s */
+    uint32_t weight;        /** share of flows for this path, proportional to linkspeed */
+    uint32_t timestamp;     /** last discovery of path */
+    uint64_t tx_count;      /** packets sent through this path */
+    uint64_t tx_bytes;      /** bytes sent through this path */
+}lsp_route_path_t;
 
 typedef struct lsp_route_s
 {
     lsp_list_t rlist; /** linked list for rtable */
-    lsp_interface_t *iface; /** interface to route packet */
-    lsp_addr_t addr; /** address of device */
-    uint32_t linkspeed; /** linkspeed of hop in bytes/s */
+    lsp_interface_t *iface; /** preferred interface to route packet (fastest path) */
+    lsp_addr_t addr; /** address of device, or network address for prefix routes */
+    uint8_t prefixlen; /** prefix length in bits, LSP_PACKET_ADDR_BITS for routes to a single device */
+    lsp_route_state_t state; /** route state */
+    uint32_t linkspeed; /** linkspeed of preferred path in bytes/s */
     uint32_t timestamp; /** last discovery of route */
+    uint32_t expiry; /** time in ms when route is demoted/expired */
+    uint8_t npaths; /** number of paths, more than one only for directly connected nodes */
+    uint32_t weight_total; /** sum of path weights */
+    lsp_route_path_t paths[LSP_DEFAULT_ROUTE_MAX_PATHS]; /** paths to device */
 #if (LSP_ROUTING_HOPS_ENABLED)
-    int numHops; 
-    lsp_hop_t *hops;
+    lsp_hop_t hop; /** next hop and cost */
+    uint8_t changed; /** route changed since last advertisement */
 #endif
 }lsp_route_t;
 
+/** LSP Routing stats for monitoring */
+typedef struct lsp_routing_stats_s
+{
+    uint32_t added;     /** total routes added */
+    uint32_t refreshed; /** total routes refreshed before expiry */
+    uint32_t demoted;   /** total routes demoted to stale */
+    uint32_t expired;   /** total routes removed from rtable */
+}lsp_routing_stats_t;
+
+/**
+ * @brief Route aging callback. Called without rtable lock held, route is a copy
+ * for ROUTE_EV_DEMOTED and is freed after returning for ROUTE_EV_EXPIRED
+ */
+typedef void (*lsp_route_cb_t)(lsp_route_t *route, lsp_route_event_t ev);
+
 /**
  * @brief Initializes the LSP Routing Module
  * 
@@ -49,21 +109,206 @@ typedef struct lsp_route_s
 int lsp_routing_init();
 
 /**
- * @brief Adds a new route if a route to addr does not exist yet
+ * @brief Removes all routes and frees allocated resources for LSP Routing Module
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_routing_free();
+
+/**
+ * @brief Adds a new route if a route to addr does not exist yet.
+ * Refreshes the route expiry if route already exists for iface,
+ * replaces the route if linkspeed is faster
  * 
  * @param iface pointer to interface
  * @param addr connected node address
- * @param linkspeed linkspeed of route, -1 for unknown
+ * @param linkspeed linkspeed of route, -1 for unknown (keeps current linkspeed on refresh)
  * @return int LSP_ERR_NONE on success, otherwise an error code
  */
 int lsp_route_add(lsp_interface_t* iface, lsp_addr_t addr, int linkspeed);
 
 /**
- * @brief Look for interface to address
+ * @brief Converts a linkspeed to route cost
+ * 
+ * @param linkspeed linkspeed in bytes/s, -1 for unknown
+ * @return uint16_t cost of link
+ */
+uint16_t lsp_route_linkcost(uint32_t linkspeed);
+
+/**
+ * @brief Updates the linkspeed of direct paths and prefix routes through iface, 
+ * e.g. with a measured estimate. Path weights, preferred paths and advertised costs follow
+ * 
+ * @param iface pointer to interface
+ * @param linkspeed linkspeed in bytes/s
+ */
+void lsp_route_set_linkspeed(lsp_interface_t *iface, uint32_t linkspeed);
+
+/**
+ * @brief Removes all paths through iface, routes without a remaining path are removed.
+ * Called when an interface is unregistered
+ * 
+ * @param iface pointer to interface
+ */
+void lsp_route_flush_iface(lsp_interface_t *iface);
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+/**
+ * @brief Updates rtable from a distance vector advertised by a neighbor.
+ * Route is replaced if cost is lower, route via the same neighbor always follows the advertised cost
+ * 
+ * @param iface interface the advertisement was received from
+ * @param addr advertised address
+ * @param next_hop address of the advertising neighbor
+ * @param cost cumulative cost including the link to next_hop
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_route_learn(lsp_interface_t *iface, lsp_addr_t addr, lsp_addr_t next_hop, uint16_t cost);
+
+/**
+ * @brief Returns the cost of a direct route to a neighbor
+ * 
+ * @param iface interface to neighbor
+ * @param addr neighbor address
+ * @return uint16_t link cost, LSP_ROUTE_COST_INFINITY if neighbor is not directly connected via iface
+ */
+uint16_t lsp_route_neighbor_cost(lsp_interface_t *iface, lsp_addr_t addr);
+
+/**
+ * @brief Iterates through rtable with rtable lock held.
+ * fn must not call other lsp_route functions
+ * 
+ * @param fn called for each route, iteration stops if fn returns non-zero
+ * @param arg argument passed to fn
+ */
+void lsp_routing_foreach(int (*fn)(lsp_route_t *route, void *arg), void *arg);
+
+/**
+ * @brief Returns the number of routes changed since the last advertisement
+ * 
+ * @return int number of changed routes
+ */
+int lsp_routing_changed();
+
+/**
+ * @brief Clears the changed flag of all routes after an advertisement was sent
+ * 
+ */
+void lsp_routing_clear_changed();
+#endif
+
+/**
+ * @brief Hash of a flow for path selection
+ * 
+ * @param src_addr source address
+ * @param src_port source port
+ * @param dst_addr destination address
+ * @param dst_port destination port
+ * @return uint32_t flow hash
+ */
+static inline uint32_t lsp_flow_hash(lsp_addr_t src_addr, uint8_t src_port, lsp_addr_t dst_addr, uint8_t dst_port)
+{
+    uint32_t h = ((uint32_t)src_addr << 16) | dst_addr;
+    h ^= (((uint32_t)src_port << 8) | dst_port) * 0x9E3779B1;
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Adds or replaces a static route to all addresses matching prefix.
+ * Prefix routes are not aged, more specific routes take precedence
+ * 
+ * @param iface pointer to interface
+ * @param addr network address
+ * @param prefixlen prefix length in bits (0-16), e.g. 8 for 0x12xx
+ * @param linkspeed linkspeed of route, -1 for unknown
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_route_add_prefix(lsp_interface_t *iface, lsp_addr_t addr, uint8_t prefixlen, int linkspeed);
+
+/**
+ * @brief Removes a static prefix route
+ * 
+ * @param addr network address
+ * @param prefixlen prefix length in bits
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_route_del_prefix(lsp_addr_t addr, uint8_t prefixlen);
+
+/**
+ * @brief Look for interface to address using longest prefix match
  * 
  * @param addr address
  * @return lsp_route_t* pointer to route
  */
 lsp_interface_t *lsp_route_find(lsp_addr_t addr);
 
+/**
+ * @brief Selects the path to address for a flow. Paths are weighted by linkspeed,
+ * packets of the same flow always take the same path while the paths don't change
+ * 
+ * @param addr address
+ * @param flowhash hash of the flow, see lsp_flow_hash
+ * @param len packet length in bytes for path accounting, 0 to resolve without accounting
+ * @return lsp_interface_t* pointer to interface, NULL if no route exists
+ */
+lsp_interface_t *lsp_route_select(lsp_addr_t addr, uint32_t flowhash, size_t len);
+
+/**
+ * @brief Accounts packets sent to address through iface to the matching path,
+ * for senders that cache the result of lsp_route_select and batch their accounting
+ * 
+ * @param addr address
+ * @param iface interface the packets were sent through
+ * @param count number of packets
+ * @param bytes total length of the packets in bytes
+ */
+void lsp_route_account(lsp_addr_t addr, lsp_interface_t *iface, uint32_t count, uint64_t bytes);
+
+/**
+ * @brief Retrieves the paths and path counters of a route
+ * 
+ * @param addr address
+ * @param paths array to write paths to
+ * @param max max number of paths to write
+ * @return int number of paths written
+ */
+int lsp_route_getpaths(lsp_addr_t addr, lsp_route_path_t *paths, int max);
+
+/**
+ * @brief Demotes/expires routes that were not refreshed within LSP_DEFAULT_ROUTE_EXPIRY_MS.
+ * Only routes due for aging are visited, called periodically from core task
+ * 
+ * @param now current time in ms
+ * @return uint32_t time in ms until the next route is due, LSP_TIMEOUT_MAX if rtable is empty
+ */
+uint32_t lsp_routing_age(uint32_t now);
+
+/**
+ * @brief Returns the rtable generation. The generation changes whenever a route is
+ * added, replaced, changes paths or expires, so results of lsp_route_find/lsp_route_select
+ * can be cached until the generation changes
+ * 
+ * @return uint32_t rtable generation
+ */
+uint32_t lsp_routing_generation();
+
+/**
+ * @brief Sets the callback for route aging events
+ * 
+ * @param cb callback, NULL to disable
+ */
+void lsp_routing_set_cb(lsp_route_cb_t cb);
+
+/**
+ * @brief Retrieves the routing stats
+ * 
+ * @param stats pointer to stats struct to write
+ */
+void lsp_routing_getstats(lsp_routing_stats_t *stats);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_SERIAL_H
+#define LSP_SERIAL_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_interface.h"
+
+/**
+ * @brief creates and registers a point-to-point interface over a serial link. 
+ * Packets are COBS encoded and terminated by a zero byte
+ * 
+ * @param name interface name
+ * @param fd open file descriptor of the tty (or pty), already set to the link baudrate.
+ * tty is switched to raw mode and owned by the interface afterwards, it is closed on error
+ * @param iface pointer to store created interface
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_serial_create(const char *name, int fd, lsp_interface_t **iface);
+
+#endif
@@ -0,0 +1,49 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_SHM_H
+#define LSP_SHM_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_interface.h"
+
+/**
+ * @brief creates an initialized shared memory region for one lsp_shm link. 
+ * The fd is shared with the peer process by fork or SCM_RIGHTS
+ * 
+ * @return int memfd of the region on success, otherwise a negative error code
+ */
+int lsp_shm_region_create();
+
+/**
+ * @brief creates and registers a zero-copy interface over a shared memory region. 
+ * Each process of the link attaches to the region with a different side
+ * 
+ * @param name interface name
+ * @param fd region created with lsp_shm_region_create
+ * @param side 0 or 1, the peer uses the other side
+ * @param busy_poll_us time to poll for packets before sleeping on the doorbell, 0 to sleep immediately
+ * @param iface pointer to store created interface
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_shm_create(const char *name, int fd, int side, int busy_poll_us, lsp_interface_t **iface);
+
+#endif
@@ -23,6 +23,14 @@
 #include <stddef.h>
 #include "lsp_types.h"
 
+/* Socket functions returning int report errors as negative LSP_ERR codes,
+ * so that lengths returned on success are never mistaken for errors */
+
+/** uint32_t, max time in us a blocking receive busy polls before sleeping, 0 to always sleep */
+#define LSP_SO_BUSY_POLL (1)
+/** lsp_spin_stats_t, read only, receive waits and their wakeup latency */
+#define LSP_SO_BUSY_POLL_STATS (2)
+
 /**
  * @brief Creates a new lsp socket
  * 
@@ -48,7 +56,7 @@ void lsp_closesocket(lsp_socket_t sock, int how);
  * @param sock socket to bind
  * @param sockaddr pointer to sockaddr with details for binding socket
  * @param addrlen not currently used but should be sizeof(lsp_sockaddr_t) for future compatibility
- * @return int LSP_ERR_NONE on success, otherwise an error code 
+ * @return int LSP_ERR_NONE on success, otherwise a negative error code
  */
 int lsp_bind(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen);
 
@@ -57,7 +65,7 @@ int lsp_bind(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen);
  * 
  * @param sock socket to listen
  * @param backlog max connections for socket 
- * @return int 
+ * @return int LSP_ERR_NONE on success, otherwise a negative error code
  */
 int lsp_listen(lsp_socket_t sock, int backlog);
 
@@ -78,7 +86,7 @@ lsp_socket_t lsp_accept(lsp_socket_t sock, uint32_t timeout);
  * @param sock socket
  * @param sockaddr pointer to sockaddr
  * @param addrlen not currently used but should be sizeof(lsp_sockaddr_t) for future compatibility
- * @return int LSP_ERR_NONE on success, otherwise an error code
+ * @return int LSP_ERR_NONE on success, otherwise a negative error code
  */
 int lsp_connect(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen);
 
@@ -89,7 +97,7 @@ int lsp_connect(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen);
  * @param buf pointer to data
  * @param buflen length of data
  * @param flags not currently used
- * @return int number of bytes sent, otherwise an error code
+ * @return int number of bytes sent, otherwise a negative error code
  */
 int lsp_send(lsp_socket_t sock, const void *buf, size_t buflen, uint32_t flags);
 
@@ -102,33 +110,35 @@ int lsp_send(lsp_socket_t sock, const void *buf, size_t buflen, uint32_t flags);
  * @param flags not currently used
  * @param sockaddr pointer to sockaddr with destination address
  * @param addrlen not currently used but should be sizeof(lsp_sockaddr_t) for future compatibility
- * @return int number of bytes sent, otherwise an error code
+ * @return int number of bytes sent, otherwise a negative error code
  */
 int lsp_sendto(lsp_socket_t sock, const void *buf, size_t buflen, uint32_t flags, lsp_sockaddr_t *sockaddr, size_t addrlen);
 
 /**
  * @brief Receives data from connected socket.
+ * Waits up to the receive timeout of the socket, busy polling first if LSP_SO_BUSY_POLL is set.
+ * Payload that does not fit in buf is discarded.
  * TODO: Add support for zero-copy semantics
  * 
  * @param sock socket
  * @param buf pointer to buffer
  * @param buflen buffer length
  * @param flags not currently used
- * @return int number of bytes written, otherwise an error code
+ * @return int number of bytes written, otherwise a negative error code
  */
 int lsp_recv(lsp_socket_t sock, void *buf, size_t buflen, uint32_t flags);
 
 /**
- * @brief Receives data from specified connection.
+ * @brief Receives data from specified connection, see lsp_recv.
  * TODO: Add support for zero-copy semantics
  * 
  * @param sock socket
  * @param buf pointer to buffer
  * @param buflen buffer length
  * @param flags not currently used
- * @param sockaddr pointer to sockaddr with source address
+ * @param sockaddr pointer to store the source address, may be NULL
  * @param addrlen not currently used but should be sizeof(lsp_sockaddr_t) for future compatibility
- * @return int number of bytes written, otherwise an error code
+ * @return int number of bytes written, otherwise a negative error code
  */
 int lsp_recvfrom(lsp_socket_t sock, void *buf, size_t buflen, uint32_t flags, lsp_sockaddr_t *sockaddr, size_t addrlen);
 
@@ -140,7 +150,7 @@ int lsp_recvfrom(lsp_socket_t sock, void *buf, size_t buflen, uint32_t flags, ls
  * @param opt option being set or modified
  * @param optval pointer to option value
  * @param optlen length of option value
- * @return int LSP_ERR_NONE on success, otherwise an error code
+ * @return int LSP_ERR_NONE on success, otherwise a negative error code
  */
 int lsp_setsockopt(lsp_socket_t sock, int level, int opt, const void *optval, size_t optlen);
 
@@ -152,7 +162,7 @@ int lsp_setsockopt(lsp_socket_t sock, int level, int opt, const void *optval, si
  * @param opt option being retrieved
  * @param optval pointer to buffer to store value
  * @param optlen length of buffer
- * @return int LSP_ERR_NONE on success, otherwise an error code
+ * @return int LSP_ERR_NONE on success, otherwise a negative error code
  */
 int lsp_getsockopt(lsp_socket_t sock, int level, int opt, void *optval, size_t optlen);
 
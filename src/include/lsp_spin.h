@@ -0,0 +1,158 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_SPIN_H
+#define LSP_SPIN_H
+
+#include "lsp_types.h"
+#include "lsp_thread.h"
+#include "lsp_time.h"
+
+/** Number of wakeup latency bins, bin i counts latencies of [2^i, 2^(i+1)) us, the last bin counts the rest */
+#define LSP_SPIN_HIST_BINS 16
+
+/** largest spin budget in us */
+#define LSP_SPIN_MAX_US 1000000
+
+/** polls between clock reads while spinning */
+#define LSP_SPIN_POLLS 32
+
+/** LSP Spin statistics */
+typedef struct lsp_spin_stats_s
+{
+    uint64_t spin_hits;                      /** waits that ended while spinning */
+    uint64_t blocks;                         /** waits that fell back to blocking */
+    uint64_t spin_hist[LSP_SPIN_HIST_BINS];  /** wakeup latency of waits that ended while spinning */
+    uint64_t block_hist[LSP_SPIN_HIST_BINS]; /** wakeup latency of waits that blocked */
+} lsp_spin_stats_t;
+
+/** LSP Adaptive spin state, owned by the waiter */
+typedef struct lsp_spin_s
+{
+    uint32_t max_us; /** spin budget, 0 to always block */
+    uint32_t avg_us; /** moving average of wait time */
+    lsp_spin_stats_t stats;
+} lsp_spin_t;
+
+/**
+ * @brief Initializes spin state and clears its statistics
+ * 
+ * @param spin spin state
+ * @param max_us spin budget in us, 0 to always block
+ */
+static inline void lsp_spin_init(lsp_spin_t *spin, uint32_t max_us)
+{
+    spin->stats = (lsp_spin_stats_t){0};
+    __atomic_store_n(&spin->max_us, max_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&spin->avg_us, max_us / 2, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Copies spin statistics that may be updated concurrently by the waiter
+ * 
+ * @param src statistics owned by the waiter
+ * @param dst where to copy
+ */
+static inline void lsp_spin_stats_read(const lsp_spin_stats_t *src, lsp_spin_stats_t *dst)
+{
+    dst->spin_hits = __atomic_load_n(&src->spin_hits, __ATOMIC_RELAXED);
+    dst->blocks = __atomic_load_n(&src->blocks, __ATOMIC_RELAXED);
+    for (int i = 0; i < LSP_SPIN_HIST_BINS; ++i)
+    {
+        dst->spin_hist[i] = __atomic_load_n(&src->spin_hist[i], __ATOMIC_RELAXED);
+        dst->block_hist[i] = __atomic_load_n(&src->block_hist[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Returns how long the next wait should spin before blocking. Spins up to
+ * twice the average wait, waits that usually outlast the budget go straight to blocking
+ * 
+ * @param spin spin state
+ * @return uint32_t time to spin in us, 0 to block right away
+ */
+static inline uint32_t lsp_spin_budget(const lsp_spin_t *spin)
+{
+    uint32_t max_us = __atomic_load_n(&spin->max_us, __ATOMIC_RELAXED);
+    uint32_t avg_us = __atomic_load_n(&spin->avg_us, __ATOMIC_RELAXED);
+
+    if (max_us == 0 || avg_us > max_us)
+        return 0;
+    return avg_us < max_us / 2 ? avg_us * 2 + 1 : max_us;
+}
+
+/**
+ * @brief Spins until ready returns non zero or the spin budget is used up
+ * 
+ * @param spin spin state
+ * @param ready readiness check, must not block
+ * @param arg argument for ready
+ * @return int 1 if ready, 0 if the caller should block
+ */
+static inline int lsp_spin_wait(const lsp_spin_t *spin, int (*ready)(void *arg), void *arg)
+{
+    uint32_t start, budget = lsp_spin_budget(spin);
+
+    if (budget == 0)
+        return 0;
+
+    start = lsp_gettime_us();
+    do
+    {
+        for (int i = 0; i < LSP_SPIN_POLLS; ++i)
+        {
+            if (ready(arg))
+                return 1;
+            lsp_cpu_relax();
+        }
+    } while (lsp_gettime_us() - start < budget);
+    return 0;
+}
+
+/**
+ * @brief Records a completed wait, updates the average and the latency histograms
+ * 
+ * @param spin spin state
+ * @param waited_us time from the start of the wait until data was taken
+ * @param latency_us time from data being queued until it was taken
+ * @param spun 1 if the wait ended while spinning
+ */
+static inline void lsp_spin_record(lsp_spin_t *spin, uint32_t waited_us, uint32_t latency_us, int spun)
+{
+    int bin = latency_us ? 31 - __builtin_clz(latency_us) : 0;
+    uint32_t max_us = __atomic_load_n(&spin->max_us, __ATOMIC_RELAXED);
+    int32_t avg_us = __atomic_load_n(&spin->avg_us, __ATOMIC_RELAXED);
+    uint64_t *count, *hist;
+
+    if (bin >= LSP_SPIN_HIST_BINS)
+        bin = LSP_SPIN_HIST_BINS - 1;
+    count = spun ? &spin->stats.spin_hits : &spin->stats.blocks;
+    hist = spun ? &spin->stats.spin_hist[bin] : &spin->stats.block_hist[bin];
+    // only the waiter writes, atomic stores keep concurrent readers from seeing torn counters
+    __atomic_store_n(count, *count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(hist, *hist + 1, __ATOMIC_RELAXED);
+
+    // long waits only need to push the average over the budget, clamp so it recovers quickly
+    if (waited_us > max_us * 2)
+        waited_us = max_us * 2;
+    __atomic_store_n(&spin->avg_us, (uint32_t)(avg_us + ((int32_t)waited_us - avg_us) / 8), __ATOMIC_RELAXED);
+}
+
+#endif
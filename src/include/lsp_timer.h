@@ -0,0 +1,104 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_TIMER_H
+#define LSP_TIMER_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_list.h"
+
+/** Forward declaration for timer structure */
+typedef struct lsp_timer_s lsp_timer_t;
+
+/**
+ * @brief Timer callback, runs on core worker 0. The timer is no longer
+ * pending when called and may be armed again from the callback
+ */
+typedef void (*lsp_timer_func_t)(lsp_timer_t *timer, void *arg);
+
+/** LSP Timer, owned by the caller and linked into the core timer wheel while pending */
+struct lsp_timer_s
+{
+    lsp_list_t entry;      /** wheel slot list */
+    uint32_t expires;      /** expiry time in ms */
+    lsp_timer_func_t func; /** callback */
+    void *arg;             /** callback argument */
+    uint8_t pending;       /** linked into the wheel */
+};
+
+/**
+ * @brief Initializes the timer wheel. Called by lsp_init
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_timer_wheel_init();
+
+/**
+ * @brief Frees the timer wheel, core must not be running
+ * 
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_timer_wheel_free();
+
+/**
+ * @brief Initializes a timer, must be called once before the timer is armed
+ * 
+ * @param timer pointer to timer
+ * @param func callback
+ * @param arg callback argument
+ */
+void lsp_timer_init(lsp_timer_t *timer, lsp_timer_func_t func, void *arg);
+
+/**
+ * @brief Arms a timer to fire after delay ms, a pending timer is moved to the new
+ * expiry. O(1), may be called from any thread
+ * 
+ * @param timer pointer to timer
+ * @param delay delay in ms
+ */
+void lsp_timer_arm(lsp_timer_t *timer, uint32_t delay);
+
+/**
+ * @brief Cancels a pending timer. O(1), may be called from any thread.
+ * Does not wait for a callback that is already running
+ * 
+ * @param timer pointer to timer
+ * @return int 1 if the timer was pending, 0 otherwise
+ */
+int lsp_timer_cancel(lsp_timer_t *timer);
+
+/**
+ * @brief Checks if a timer is armed
+ * 
+ * @param timer pointer to timer
+ * @return int 1 if the timer is pending, 0 otherwise
+ */
+int lsp_timer_pending(lsp_timer_t *timer);
+
+/**
+ * @brief Runs the callbacks of all timers due at now. Called from core task
+ * 
+ * @param now current time in ms
+ * @return uint32_t time in ms until the next timer is due, LSP_TIMEOUT_MAX if none is pending
+ */
+uint32_t lsp_timer_run(uint32_t now);
+
+#endif
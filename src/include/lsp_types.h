@@ -111,6 +111,9 @@ typedef enum
 /** LSP typedef for address */
 typedef uint16_t lsp_addr_t;
 
+/** LSP typedef for cpu sets, bit n selects cpu n */
+typedef uint64_t lsp_cpumask_t;
+
 /** Forward declaration for conf structure */
 typedef struct lsp_conf_s lsp_conf_t;
 
@@ -0,0 +1,55 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_UDP_H
+#define LSP_UDP_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_interface.h"
+
+/**
+ * @brief creates and registers a point-to-point interface that carries lsp packets 
+ * over UDP datagrams, one packet per datagram
+ * 
+ * @param name interface name
+ * @param lhost local IPv4 address to bind to, NULL for any
+ * @param lport local UDP port
+ * @param rhost remote IPv4 address
+ * @param rport remote UDP port
+ * @param iface pointer to store created interface
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_udp_create_inet(const char *name, const char *lhost, uint16_t lport,
+                        const char *rhost, uint16_t rport, lsp_interface_t **iface);
+
+/**
+ * @brief creates and registers a point-to-point interface that carries lsp packets 
+ * over AF_UNIX datagram sockets, one packet per datagram
+ * 
+ * @param name interface name
+ * @param lpath local socket path, removed first if it exists
+ * @param rpath remote socket path
+ * @param iface pointer to store created interface
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_udp_create_unix(const char *name, const char *lpath, const char *rpath, lsp_interface_t **iface);
+
+#endif
@@ -0,0 +1,41 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#ifndef LSP_VETH_H
+#define LSP_VETH_H
+
+#include <stddef.h>
+#include "lsp_types.h"
+#include "lsp_interface.h"
+
+/**
+ * @brief creates and registers a pair of in-process virtual interfaces named
+ * <name>0 and <name>1. Packets transmitted on one end are received on the other end.
+ * Buffers are lent to the other end without copying and complete once it frees them
+ * 
+ * @param name interface name prefix
+ * @param tx_queuelen max length of tx queue of each end
+ * @param end0 pointer to store first end
+ * @param end1 pointer to store second end
+ * @return int LSP_ERR_NONE on success, otherwise an error code
+ */
+int lsp_veth_create(const char *name, int tx_queuelen, lsp_interface_t **end0, lsp_interface_t **end1);
+
+#endif
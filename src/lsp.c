@@ -0,0 +1,85 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_core.h"
+#include "lsp_conn.h"
+#include "lsp_port.h"
+#include "lsp_routing.h"
+#include "lsp_iflist.h"
+#include "lsp_timer.h"
+#include "lsp_link.h"
+#include "lsp_log.h"
+
+static const char *tag = "lsp";
+
+int lsp_init(lsp_conf_t *conf)
+{
+    int rc;
+
+    rc = lsp_conf_init(conf);
+    if (rc != LSP_ERR_NONE)
+        goto end;
+
+    rc = lsp_iflist_init();
+    if (rc != LSP_ERR_NONE)
+        goto end;
+
+    rc = lsp_timer_wheel_init();
+    if (rc != LSP_ERR_NONE)
+        goto iflist_err;
+
+    rc = lsp_routing_init();
+    if (rc != LSP_ERR_NONE)
+        goto timer_err;
+
+    rc = lsp_port_init();
+    if (rc != LSP_ERR_NONE)
+        goto routing_err;
+
+    rc = lsp_conn_init();
+    if (rc != LSP_ERR_NONE)
+        goto port_err;
+
+    rc = lsp_core_start();
+    if (rc != LSP_ERR_NONE)
+        goto conn_err;
+
+#if (LSP_LINK_EST_ENABLED)
+    lsp_link_start();
+#endif
+
+    lsp_info(tag, "%s: started %s (%04X)\n", __FUNCTION__, lsp_conf->hostname, lsp_conf->addr);
+    return LSP_ERR_NONE;
+
+conn_err:
+    lsp_conn_pool_free();
+port_err:
+    lsp_port_free();
+routing_err:
+    lsp_routing_free();
+timer_err:
+    lsp_timer_wheel_free();
+iflist_err:
+    lsp_iflist_free();
+end:
+    lsp_err(tag, "%s: failed to initialize %d\n", __FUNCTION__, rc);
+    return rc;
+}
@@ -28,7 +28,17 @@ static const char *tag = "lsp_buffer";
 lsp_buffer_t *lsp_buffer_alloc(lsp_interface_t *iface, size_t len)
 {
     size_t headroom = (iface != NULL ? iface->min_header_len : LSP_DEFAULT_BUFFER_HEADER_LEN);
-    lsp_buffer_t *buff = lsp_malloc(ALIGNED_SIZEOF(lsp_buffer_t) + len + headroom);
+    lsp_buffer_t *buff;
+
+    // zero-copy drivers hand out their own memory, fall back to heap when exhausted
+    if (iface != NULL && iface->ops != NULL && iface->ops->alloc != NULL)
+    {
+        buff = iface->ops->alloc(iface, len);
+        if (buff != NULL)
+            return buff;
+    }
+
+    buff = lsp_malloc(ALIGNED_SIZEOF(lsp_buffer_t) + len + headroom);
     lsp_verb(tag, "%s: %p struct size %d buff size %d 0x%x\n",
              __FUNCTION__, buff, ALIGNED_SIZEOF(lsp_buffer_t), ALIGNED_SIZEOF(lsp_buffer_t) + len + headroom, ALIGNED_SIZEOF(lsp_buffer_t) + len + headroom);
     if (buff == NULL)
@@ -44,6 +54,32 @@ lsp_buffer_t *lsp_buffer_alloc(lsp_interface_t *iface, size_t len)
     buff->headroom = headroom;
     buff->tailroom = len;
     buff->lsp_packet = (typeof(buff->lsp_packet))buff->data;
+    buff->priority = LSP_CONN_PRIO_DEF;
+    buff->release = NULL;
+    buff->release_arg = NULL;
+    return buff;
+}
+
+lsp_buffer_t *lsp_buffer_wrap(lsp_interface_t *iface, void *mem, size_t size, size_t headroom,
+                              void (*release)(lsp_buffer_t *buff), void *arg)
+{
+    lsp_buffer_t *buff = lsp_malloc(sizeof(lsp_buffer_t));
+    if (buff == NULL)
+    {
+        lsp_dbg(tag, "could not allocate lsp_buffer\n");
+        return NULL;
+    }
+
+    buff->iface = iface;
+    buff->head = mem;
+    buff->data = buff->tail = buff->head + headroom;
+    buff->end = buff->head + size;
+    buff->headroom = headroom;
+    buff->tailroom = size - headroom;
+    buff->lsp_packet = (typeof(buff->lsp_packet))buff->data;
+    buff->priority = LSP_CONN_PRIO_DEF;
+    buff->release = release;
+    buff->release_arg = arg;
     return buff;
 }
 
@@ -93,6 +129,8 @@ void *lsp_buffer_pull(lsp_buffer_t *buff, size_t len)
 
 int lsp_buffer_free(lsp_buffer_t *buff)
 {
+    if (buff->release != NULL)
+        buff->release(buff);
     lsp_free(buff);
     return LSP_ERR_NONE;
 }
@@ -28,7 +28,13 @@ static lsp_conf_t _lsp_conf = {
     .machinename = LSP_DEFAULT_MACHINENAME,
     .rev = LSP_DEFAULT_LSPREV,
     .conn_max = LSP_DEFAULT_MAX_CONNECTIONS,
-    .conn_queuelen = LSP_DEFAULT_CONN_QUEUELEN};
+    .conn_queuelen = LSP_DEFAULT_CONN_QUEUELEN,
+    .tx_workers = LSP_DEFAULT_IF_TX_WORKERS,
+    .tx_cpus = LSP_DEFAULT_IF_TX_CPUS,
+    .core_workers = LSP_DEFAULT_CORE_WORKERS,
+    .core_cpus = LSP_DEFAULT_CORE_CPUS,
+    .core_budget = LSP_DEFAULT_CORE_BUDGET,
+    .core_spin_us = LSP_DEFAULT_CORE_SPIN_US};
 
 const lsp_conf_t *const lsp_conf = &_lsp_conf;
 
@@ -40,11 +46,37 @@ int lsp_conf_init(lsp_conf_t *conf)
         return LSP_ERR_NONE;
     }
 
+    // lsp_addr_t holds exactly 16 address bits, narrower packet addresses need a check
+#if (LSP_PACKET_ADDR_BITS < 16)
     if (conf->addr > LSP_PACKET_ADDR_MAX)
     {
         lsp_verb(tag, "%s: address out of range\n", __FUNCTION__);
         return LSP_ERR_ADDR_INVALID;
     }
+#endif
+
+    if (conf->core_workers > LSP_DEFAULT_CORE_WORKERS_MAX)
+    {
+        lsp_verb(tag, "%s: core_workers out of range\n", __FUNCTION__);
+        return LSP_ERR_INVALID;
+    }
+
+#if (LSP_CORE_POLL)
+    if (conf->core_workers > 1 || conf->tx_workers)
+    {
+        lsp_verb(tag, "%s: core and tx workers are not available with LSP_CORE_POLL\n", __FUNCTION__);
+        return LSP_ERR_INVALID;
+    }
+#endif
+
+    // core_budget is a uint8_t, larger limits need no check
+#if (LSP_DEFAULT_CORE_BUDGET_MAX < UINT8_MAX)
+    if (conf->core_budget > LSP_DEFAULT_CORE_BUDGET_MAX)
+    {
+        lsp_verb(tag, "%s: core_budget out of range\n", __FUNCTION__);
+        return LSP_ERR_INVALID;
+    }
+#endif
 
     if (conf->hostname == NULL)
         lsp_verb(tag, "%s: null hostname, loading defaults\n", __FUNCTION__);
@@ -61,6 +93,12 @@ int lsp_conf_init(lsp_conf_t *conf)
     _lsp_conf.rev = conf->rev;
     _lsp_conf.conn_max = conf->conn_max;
     _lsp_conf.conn_queuelen = conf->conn_queuelen;
+    _lsp_conf.tx_workers = conf->tx_workers;
+    _lsp_conf.tx_cpus = conf->tx_cpus;
+    _lsp_conf.core_workers = conf->core_workers ? conf->core_workers : 1;
+    _lsp_conf.core_cpus = conf->core_cpus;
+    _lsp_conf.core_budget = conf->core_budget ? conf->core_budget : LSP_DEFAULT_CORE_BUDGET;
+    _lsp_conf.core_spin_us = conf->core_spin_us;
 
     return LSP_ERR_NONE;
 }
\ No newline at end of file
@@ -66,7 +66,8 @@ int lsp_conn_init()
     if (conn_pool == NULL)
     {
         lsp_verb(tag, "%s: could not allocate conn_pool\n", __FUNCTION__);
-        return -LSP_ERR_NOMEM;
+        rc = -LSP_ERR_NOMEM;
+        goto mutex_err;
     }
     memset(conn_pool, 0, blocksize);
     lsp_verb(tag, "%s: allocated %d bytes for conn_pool poolsize: %d connsize: %d\n", __FUNCTION__, blocksize, lsp_conf->conn_max, sizeof(lsp_conn_t));
@@ -93,16 +94,47 @@ int lsp_conn_init()
             goto egroup_err;
         conn_pool[i].egroup = &egroup_pool[i];
     }
+#endif
+    return LSP_ERR_NONE;
 
+#if (LSP_CONN_EGROUP_POOL)
 egroup_err:
     lsp_free(egroup_pool);
-#endif
+    egroup_pool = NULL;
 conn_err:
     lsp_free(conn_pool);
-end:
+    conn_pool = NULL;
+#endif
+mutex_err:
+    lsp_mutex_destroy(&conn_mutex);
     return rc;
 }
 
+int lsp_conn_pool_free()
+{
+    if (conn_pool == NULL)
+        return LSP_ERR_NONE;
+
+    // queues and event groups are created on first use of a connection
+    for (int i = 0; i < lsp_conf->conn_max; ++i)
+    {
+        if (conn_pool[i].rx_queue != NULL)
+            lsp_queue_destroy(conn_pool[i].rx_queue);
+#if !(LSP_CONN_EGROUP_POOL)
+        if (conn_pool[i].egroup != NULL)
+            lsp_egroup_destroy(conn_pool[i].egroup);
+#endif
+    }
+
+#if (LSP_CONN_EGROUP_POOL)
+    lsp_free(egroup_pool);
+    egroup_pool = NULL;
+#endif
+    lsp_free(conn_pool);
+    conn_pool = NULL;
+    return lsp_mutex_destroy(&conn_mutex);
+}
+
 lsp_conn_t *lsp_conn_alloc()
 {
     int rc;
@@ -156,6 +188,8 @@ lsp_conn_t *lsp_conn_alloc()
     conn->rcv_timeout = LSP_TIMEOUT_MAX;
     conn->snd_timeout = LSP_TIMEOUT_MAX;
     conn->s_opt = 0;
+    conn->iface = NULL;
+    lsp_queue_set_spin(conn->rx_queue, 0);
 
     return conn;
 err:
@@ -177,6 +211,7 @@ int lsp_conn_close(lsp_conn_t *conn)
     // Set connection to closed
     conn->state = CONN_CLOSED;
     lsp_list_del(&conn->portlist);
+    lsp_conn_account_flush(conn);
 
     // flush rxq
     rc = lsp_conn_rxq_flush(conn);
@@ -192,11 +227,8 @@ int lsp_conn_close(lsp_conn_t *conn)
 #endif
 
 #if !(LSP_CONN_EGROUP_POOL)
-    rc = lsp_egroup_destroy(conn->egroup);
-    if(rc == LSP_ERR_NONE)
-        conn->egroup = NULL;
-    else 
-        lsp_err(tag, "%s: could not destroy egroup for lsp_conn\n", __FUNCTION__);
+    lsp_egroup_destroy(conn->egroup);
+    conn->egroup = NULL;
 #endif
 
 end:
@@ -239,7 +271,36 @@ int lsp_conn_rxq_flush(lsp_conn_t *conn)
     return LSP_ERR_NONE;
 }
 
-int lsp_conn_rxq_push(lsp_conn_t *conn, lsp_buffer_t *buffer)
+int lsp_conn_rxq_push(lsp_conn_t *conn, lsp_buffer_t *buffer, uint32_t timeout)
+{
+    return lsp_queue_push(conn->rx_queue, &buffer, timeout);
+}
+
+void lsp_conn_account_flush(lsp_conn_t *conn)
+{
+    uint32_t count = __atomic_exchange_n(&conn->acct_count, 0, __ATOMIC_RELAXED);
+    uint64_t bytes = __atomic_exchange_n(&conn->acct_bytes, 0, __ATOMIC_RELAXED);
+
+    if (count > 0 && conn->iface != NULL)
+        lsp_route_account(conn->attr.raddr, conn->iface, count, bytes);
+}
+
+int lsp_conn_route(lsp_conn_t *conn)
 {
-    return lsp_queue_push(conn->rx_queue, &buffer, LSP_DEFAULT_QUEUE_TIMEOUT_MS);
-}
\ No newline at end of file
+    // read generation first so a concurrent rtable change invalidates this result
+    uint32_t gen = lsp_routing_generation();
+
+    // packets batched so far went through the old path
+    lsp_conn_account_flush(conn);
+
+    conn->flowhash = lsp_flow_hash(lsp_conf->addr, conn->attr.lport, conn->attr.raddr, conn->attr.rport);
+    // resolved once per rtable generation, lsp_send batches path accounting with lsp_conn_account
+    conn->iface = lsp_route_select(conn->attr.raddr, conn->flowhash, 0);
+    conn->route_gen = gen;
+    if (conn->iface == NULL)
+    {
+        lsp_verb(tag, "%s: no route to %04X\n", __FUNCTION__, conn->attr.raddr);
+        return LSP_ERR_ADDR_NOTFOUND;
+    }
+    return LSP_ERR_NONE;
+}
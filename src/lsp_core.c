@@ -18,99 +18,426 @@
  */
 
 #include "lsp.h"
+#include "lsp_core.h"
 #include "lsp_port.h"
 #include "lsp_memory.h"
 #include "lsp_conn.h"
 #include "lsp_log.h"
 #include "lsp_thread.h"
+#include "lsp_time.h"
+#include "lsp_routing.h"
+#include "lsp_buffer.h"
+#include "lsp_mesh.h"
+#include "lsp_forward.h"
+#include "lsp_link.h"
+#include "lsp_timer.h"
+#include "lsp_evq.h"
+#include "lsp_egroup.h"
+#include "lsp_interface.h"
 
+#include "stdio.h"
 #include "string.h"
 
 static const char *tag = "lsp_core";
 
-struct lsp_core_event {
-    lsp_events_t ev;
-    void *data;
+/** bit set on the egroup of LSP_EV_BARRIER by worker n is (1 << n) */
+#define LSP_CORE_BARRIER_BIT(n) (1 << (n))
+
+/** LSP Core worker, owns the flows steered to its event queue */
+struct lsp_core_worker {
+    lsp_thread_handle_t thread;
+    lsp_evq_t *evqueue;
+    uint8_t id;
+    char name[12];
+    lsp_core_stats_t stats;
+
+    /** events of the current batch, grouped by type before handling */
+    lsp_evq_entry_t batch[LSP_DEFAULT_CORE_BUDGET_MAX];
+    lsp_buffer_t *rx[LSP_DEFAULT_CORE_BUDGET_MAX];
+    lsp_interface_t *tx[LSP_DEFAULT_CORE_BUDGET_MAX];
 };
 
-/** LSP Core thread handle */
-static lsp_thread_handle_t lsp_core_thread;
-/** LSP Core Event Queue */
-static lsp_queue_handle_t lsp_core_evqueue;
+/** LSP Core workers, worker 0 also runs routing, mesh and the timer wheel */
+static struct lsp_core_worker lsp_core_workers[LSP_DEFAULT_CORE_WORKERS_MAX];
+static uint8_t lsp_core_nworkers;
 
+#if !(LSP_CORE_POLL)
 lsp_thread_return_t lsp_core_task(void *arg);
+#endif
+
+/** returns the n-th allowed cpu in cpus wrapping around, 0 if any cpu is allowed */
+static lsp_cpumask_t lsp_core_cpu(lsp_cpumask_t cpus, int n)
+{
+    int count = __builtin_popcountll(cpus);
+
+    if (count == 0)
+        return 0;
+
+    for (n %= count; n > 0; --n)
+        cpus &= cpus - 1;
+    return cpus & -cpus;
+}
 
 int lsp_core_start()
 {
-    /** TODO: maybe add support for multithreaded core task */
-    int rc;
-    
-    lsp_core_evqueue = lsp_queue_create(LSP_DEFAULT_CORE_EVQUEUE_LEN, sizeof(struct lsp_core_event));
-    if(lsp_core_evqueue == NULL)
+    int rc = LSP_ERR_NOMEM;
+    struct lsp_core_worker *worker;
+    uint8_t n = lsp_conf->core_workers ? lsp_conf->core_workers : 1;
+
+    for (lsp_core_nworkers = 0; lsp_core_nworkers < n; ++lsp_core_nworkers)
     {
-        lsp_err(tag, "%s: failed to create event queue\n", __FUNCTION__);
-        goto end;
+        worker = &lsp_core_workers[lsp_core_nworkers];
+        worker->id = lsp_core_nworkers;
+        snprintf(worker->name, sizeof(worker->name), "lsp_core%u", worker->id);
+
+        worker->evqueue = lsp_evq_create(LSP_DEFAULT_CORE_EVQUEUE_LEN);
+        if (worker->evqueue == NULL)
+        {
+            lsp_err(tag, "%s: failed to create event queue\n", __FUNCTION__);
+            rc = LSP_ERR_NOMEM;
+            goto err;
+        }
+        lsp_evq_set_spin(worker->evqueue, lsp_conf->core_spin_us);
+
+#if !(LSP_CORE_POLL)
+        rc = lsp_thread_create(lsp_core_task, worker->name, LSP_DEFAULT_CORE_STACK_SIZE, worker,
+                               LSP_DEFAULT_CORE_PRIORITY, &worker->thread);
+        if (rc != LSP_ERR_NONE)
+        {
+            lsp_err(tag, "%s: failed to create thread\n", __FUNCTION__);
+            lsp_evq_destroy(worker->evqueue);
+            goto err;
+        }
+
+        if (lsp_thread_setaffinity(worker->thread, lsp_core_cpu(lsp_conf->core_cpus, worker->id)) != LSP_ERR_NONE)
+            lsp_warn(tag, "%s: could not pin %s\n", __FUNCTION__, worker->name);
+#endif
     }
+    return LSP_ERR_NONE;
+
+err:
+    // workers that already started keep running, events are only steered to the first ones
+    if (lsp_core_nworkers == 0)
+        return rc;
+    lsp_warn(tag, "%s: running with %u of %u workers\n", __FUNCTION__, lsp_core_nworkers, n);
+    return LSP_ERR_NONE;
+}
 
-    // create with 2048 stack size
-    rc = lsp_thread_create(lsp_core_task, "lsp_core", 2048, NULL, LSP_DEFAULT_CORE_PRIORITY, &lsp_core_thread);
-    if (rc != LSP_ERR_NONE)
+/** mesh and link probes share state with the timers on worker 0, runts are dropped there */
+static inline int lsp_core_is_control(lsp_buffer_t *buff)
+{
+    lsp_packet_t *pkt = (lsp_packet_t *)buff->data;
+
+    return lsp_buffer_length(buff) < sizeof(lsp_packet_t) ||
+           pkt->dst_port == LSP_SP_SYS || pkt->dst_port == LSP_SP_PING;
+}
+
+/** returns the worker that handles an event, the same flow or interface always maps to the same worker */
+static inline struct lsp_core_worker *lsp_core_steer(lsp_events_t ev, void *data)
+{
+    lsp_buffer_t *buff;
+    lsp_packet_t *pkt;
+    uint32_t hash;
+
+    if (lsp_core_nworkers == 1)
+        return &lsp_core_workers[0];
+
+    switch (ev)
     {
-        lsp_err(tag, "%s: failed to create thread\n", __FUNCTION__);
-        goto queue_err;
+        case LSP_EV_NET_RX_EVENT:
+            buff = data;
+            if (lsp_core_is_control(buff))
+                return &lsp_core_workers[0];
+            pkt = (lsp_packet_t *)buff->data;
+            hash = lsp_flow_hash(pkt->src_addr, pkt->src_port, pkt->dst_addr, pkt->dst_port);
+            break;
+        case LSP_EV_NET_TX_EVENT:
+            hash = ((lsp_interface_t *)data)->index;
+            break;
+        default:
+            return &lsp_core_workers[0];
     }
+    return &lsp_core_workers[hash % lsp_core_nworkers];
+}
 
-queue_err:
-    lsp_queue_destroy(lsp_core_evqueue);
-end:
-    return rc;
+/** delivers a received packet, timeout bounds the wait for space in the socket rx_queue */
+static int lsp_core_handle_rxev(lsp_buffer_t *buff, uint32_t timeout)
+{
+    lsp_packet_t *pkt;
+
+    if (lsp_buffer_length(buff) < sizeof(lsp_packet_t))
+    {
+        lsp_verb(tag, "%s: runt packet from %s\n", __FUNCTION__, buff->iface->ifname);
+        LSP_IF_STATS_INC(buff->iface, rx_error);
+        lsp_buffer_free(buff);
+        return LSP_ERR_INVALID;
+    }
+
+    pkt = buff->lsp_packet = (lsp_packet_t *)buff->data;
+    if (pkt->dst_addr != lsp_conf->addr && pkt->dst_addr != LSP_ADDR_ANY)
+    {
+#if (LSP_FORWARDING_ENABLED)
+        // relay without entering the socket layer
+        return lsp_forward(buff);
+#else
+        lsp_verb(tag, "%s: dropping packet for %04X\n", __FUNCTION__, pkt->dst_addr);
+        LSP_IF_STATS_INC(buff->iface, dropped);
+        lsp_buffer_free(buff);
+        return LSP_ERR_ADDR_NOTFOUND;
+#endif
+    }
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+    if (pkt->dst_port == LSP_SP_SYS)
+        return lsp_mesh_input(buff);
+#endif
+#if (LSP_LINK_EST_ENABLED)
+    if (pkt->dst_port == LSP_SP_PING)
+        return lsp_link_input(buff);
+#endif
+
+    return lsp_port_input(buff, timeout);
 }
 
-int lsp_core_handle_rxev(void * data)
+int lsp_core_input(lsp_buffer_t *buff)
 {
-    /** TODO: Handle rx packets here */
+    if (lsp_core_is_control(buff))
+        return lsp_core_sendevent(LSP_EV_NET_RX_EVENT, buff);
+
+    // caller holds the iflist read lock in the driver's rx thread, never wait on a full socket
+    lsp_core_handle_rxev(buff, 0);
+    return LSP_ERR_NONE;
 }
 
-lsp_thread_return_t lsp_core_task(void *arg)
+/** handles the grouped events of a batch, rx first so that forwarded packets go out with the tx drains */
+static void lsp_core_flush(struct lsp_core_worker *worker, int *nrx, int *ntx)
 {
-    int rc;
-    struct lsp_core_event event;
-    uint32_t nextSleep = 500; /** TODO: do calculation to get next sleep time */
-    for (;;)
+    for (int i = 0; i < *nrx; ++i)
     {
-        rc = lsp_queue_pop(lsp_core_evqueue, &event, nextSleep);
-        if(rc == LSP_ERR_TIMEOUT || rc == LSP_ERR_QUEUE_EMPTY)
-        {
-            event.ev = LSP_EV_NO_EVENT;
-        }
-        else if (rc != LSP_ERR_NONE){
-            event.ev = LSP_EV_NO_EVENT;
-            lsp_err(tag, "%s: event queue error %d\n", __FUNCTION__, rc);
-        }
+        if (i + 1 < *nrx)
+            __builtin_prefetch(worker->rx[i + 1]->data);
+        lsp_core_handle_rxev(worker->rx[i], LSP_DEFAULT_QUEUE_TIMEOUT_MS);
+    }
+    for (int i = 0; i < *ntx; ++i)
+        lsp_interface_txq_drain(worker->tx[i]);
+    *nrx = 0;
+    *ntx = 0;
+}
+
+static void lsp_core_handle_batch(struct lsp_core_worker *worker, int n)
+{
+    int i, j, nrx = 0, ntx = 0;
+    lsp_evq_entry_t *event;
 
-        switch(event.ev)
+    for (i = 0; i < n; ++i)
+    {
+        event = &worker->batch[i];
+        switch (event->ev)
         {
             case LSP_EV_NO_EVENT:
                 break;
             case LSP_EV_NET_RX_EVENT:
-
+                worker->rx[nrx++] = event->data;
+                break;
+            case LSP_EV_NET_TX_EVENT:
+                // one drain per interface and batch
+                for (j = 0; j < ntx && worker->tx[j] != event->data; ++j)
+                    ;
+                if (j == ntx)
+                    worker->tx[ntx++] = event->data;
+                break;
+            case LSP_EV_BARRIER:
+                lsp_core_flush(worker, &nrx, &ntx);
+                lsp_egroup_set(event->data, LSP_CORE_BARRIER_BIT(worker->id));
                 break;
         }
     }
+    lsp_core_flush(worker, &nrx, &ntx);
+}
+
+/** waits up to *nextSleep for one batch and handles it, worker 0 then runs the timers.
+ * Returns the number of events handled, *nextSleep is set to the wait before the next batch */
+static int lsp_core_run(struct lsp_core_worker *worker, uint8_t budget, uint32_t *nextSleep)
+{
+    int n;
+    uint32_t now, meshSleep, timerSleep;
+
+    n = lsp_evq_pop_burst(worker->evqueue, worker->batch, budget, *nextSleep);
+    if (n > 0)
+    {
+        lsp_core_handle_batch(worker, n);
+        // only this worker writes its stats, atomic stores keep lsp_core_getstats from reading torn values
+        __atomic_store_n(&worker->stats.batches, worker->stats.batches + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&worker->stats.events, worker->stats.events + n, __ATOMIC_RELAXED);
+        if ((uint32_t)n > worker->stats.batch_max)
+            __atomic_store_n(&worker->stats.batch_max, (uint32_t)n, __ATOMIC_RELAXED);
+    }
+
+    // more events are waiting, only yield to timers before the next batch
+    if (n == budget)
+        __atomic_store_n(&worker->stats.budget_exhausted, worker->stats.budget_exhausted + 1, __ATOMIC_RELAXED);
+
+    // timers are only run by worker 0, the others just wait for events
+    if (worker->id != 0)
+    {
+        *nextSleep = n == budget ? 0 : LSP_DEFAULT_CORE_MAX_SLEEP_MS;
+        return n;
+    }
+
+    // age routes and wake up again when the next one is due
+    now = lsp_gettime_ms();
+    *nextSleep = lsp_routing_age(now);
+#if (LSP_ROUTING_HOPS_ENABLED)
+    meshSleep = lsp_mesh_tick(now);
+    if (meshSleep < *nextSleep)
+        *nextSleep = meshSleep;
+#endif
+    // sleep exactly until the next timer, arming an earlier one wakes core up
+    timerSleep = lsp_timer_run(now);
+    if (timerSleep < *nextSleep)
+        *nextSleep = timerSleep;
+    if (*nextSleep > LSP_DEFAULT_CORE_MAX_SLEEP_MS)
+        *nextSleep = LSP_DEFAULT_CORE_MAX_SLEEP_MS;
+    if (n == budget)
+        *nextSleep = 0;
+    return n;
+}
+
+#if (LSP_CORE_POLL)
+/** how long the application may wait before the next lsp_core_poll */
+static uint32_t lsp_core_poll_sleep;
+
+int lsp_core_poll(uint8_t budget)
+{
+    uint32_t nextSleep = 0;
+    int n;
+
+    if (lsp_core_nworkers == 0)
+        return -LSP_ERR_INVALID;
+    if (budget == 0 || budget > LSP_DEFAULT_CORE_BUDGET_MAX)
+        budget = lsp_conf->core_budget;
+
+    n = lsp_core_run(&lsp_core_workers[0], budget, &nextSleep);
+    lsp_core_poll_sleep = nextSleep;
+    return n;
+}
+
+uint32_t lsp_core_poll_timeout()
+{
+    return lsp_core_poll_sleep;
+}
+#else
+lsp_thread_return_t lsp_core_task(void *arg)
+{
+    struct lsp_core_worker *worker = arg;
+    uint8_t budget = lsp_conf->core_budget;
+    // run timers armed before core started right away
+    uint32_t nextSleep = 0;
+    for (;;)
+        lsp_core_run(worker, budget, &nextSleep);
+}
+#endif
+
+int lsp_core_getstats(uint8_t worker, lsp_core_stats_t *stats)
+{
+    const lsp_core_stats_t *src;
+
+    if (worker >= lsp_core_nworkers)
+        return LSP_ERR_INVALID;
+
+    src = &lsp_core_workers[worker].stats;
+    stats->batches = __atomic_load_n(&src->batches, __ATOMIC_RELAXED);
+    stats->events = __atomic_load_n(&src->events, __ATOMIC_RELAXED);
+    stats->budget_exhausted = __atomic_load_n(&src->budget_exhausted, __ATOMIC_RELAXED);
+    stats->batch_max = __atomic_load_n(&src->batch_max, __ATOMIC_RELAXED);
+    lsp_evq_getspin(lsp_core_workers[worker].evqueue, &stats->spin);
+    return LSP_ERR_NONE;
 }
 
 int lsp_core_sendevent(lsp_events_t ev, void *data)
 {
     int rc;
-    struct lsp_core_event event = {
-        .ev = ev,
-        .data = data
-    };
 
-    rc = lsp_queue_push(lsp_core_evqueue, &event, 0);
+    rc = lsp_evq_push(lsp_core_steer(ev, data)->evqueue, ev, data);
     if(rc != LSP_ERR_NONE)
     {
         lsp_verb(tag, "%s: could not push to evqueue err: %d\n", __FUNCTION__, rc);
     }
     return rc;
-}
\ No newline at end of file
+}
+
+int lsp_core_sendevent_burst(lsp_events_t ev, void **data, int n)
+{
+    int i, m, pushed, count = 0, rejected = 0;
+    lsp_evq_entry_t events[LSP_DEFAULT_IF_RX_BURST];
+    struct lsp_core_worker *steer[LSP_DEFAULT_IF_RX_BURST];
+    void *queued[LSP_DEFAULT_IF_RX_BURST];
+    void *dropped[LSP_DEFAULT_IF_RX_BURST];
+
+    if (n > LSP_DEFAULT_IF_RX_BURST)
+        n = LSP_DEFAULT_IF_RX_BURST;
+
+    for (i = 0; i < n; ++i)
+        steer[i] = lsp_core_steer(ev, data[i]);
+
+    // one push per worker, events of a flow keep their order within the worker's queue
+    for (int w = 0; w < lsp_core_nworkers; ++w)
+    {
+        for (i = 0, m = 0; i < n; ++i)
+        {
+            if (steer[i] != &lsp_core_workers[w])
+                continue;
+            events[m].ev = ev;
+            events[m++].data = data[i];
+        }
+        if (m == 0)
+            continue;
+
+        pushed = lsp_evq_push_burst(lsp_core_workers[w].evqueue, events, m);
+        for (i = 0; i < m; ++i)
+        {
+            if (i < pushed)
+                queued[count++] = events[i].data;
+            else
+                dropped[rejected++] = events[i].data;
+        }
+    }
+
+    if (count != n)
+    {
+        // callers free data[count..n), move rejected events behind the queued ones
+        memcpy(data, queued, count * sizeof(void *));
+        memcpy(&data[count], dropped, rejected * sizeof(void *));
+        lsp_verb(tag, "%s: evqueue full, queued %d of %d\n", __FUNCTION__, count, n);
+    }
+    return count;
+}
+
+int lsp_core_barrier()
+{
+#if (LSP_CORE_POLL)
+    // the caller owns the core, handle everything that is queued right here
+    while (lsp_core_poll(0) > 0)
+        ;
+    return LSP_ERR_NONE;
+#else
+    lsp_egroup_bits_t bits = 0;
+    lsp_egroup_handle_t done = lsp_egroup_create();
+
+    if (done == NULL)
+        return LSP_ERR_NOMEM;
+
+    // evqueues are FIFO, each worker reaches the barrier after everything queued to it before
+    for (int w = 0; w < lsp_core_nworkers; ++w)
+    {
+        // producers never block on the evqueue, retry until the worker made room
+        while (lsp_evq_push(lsp_core_workers[w].evqueue, LSP_EV_BARRIER, done) != LSP_ERR_NONE)
+            lsp_thread_sleep(1);
+        bits |= LSP_CORE_BARRIER_BIT(w);
+    }
+
+    lsp_egroup_wait(done, bits, 1, 1, LSP_TIMEOUT_MAX);
+    lsp_egroup_destroy(done);
+    return LSP_ERR_NONE;
+#endif
+}
@@ -0,0 +1,189 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_evq.h"
+#include "lsp_egroup.h"
+#include "lsp_memory.h"
+#include "lsp_log.h"
+#include "lsp_time.h"
+
+static const char *tag = "lsp_evq";
+
+/** egroup bit set by producers to wake the consumer */
+#define EVQ_WAKE (1 << 0)
+
+/** slot is readable once seq is its position + 1 */
+struct lsp_evq_slot
+{
+    uint32_t seq;
+    lsp_evq_entry_t entry;
+};
+
+/** tail is shared by producers, head, sleeping and spin are written by the consumer only */
+struct lsp_evq_s
+{
+    uint32_t tail __attribute__((aligned(64))); /** next position reserved by producers */
+    uint32_t head __attribute__((aligned(64))); /** next position read by consumer */
+    uint32_t sleeping __attribute__((aligned(64))); /** consumer waits on wake */
+    uint32_t mask;
+    lsp_egroup_handle_t wake;
+    lsp_spin_t spin;
+    struct lsp_evq_slot slots[];
+};
+
+lsp_evq_t *lsp_evq_create(uint32_t len)
+{
+    lsp_evq_t *evq;
+    uint32_t cap = 2;
+
+    while (cap < len)
+        cap <<= 1;
+
+    evq = lsp_malloc(sizeof(lsp_evq_t) + cap * sizeof(struct lsp_evq_slot));
+    if (evq == NULL)
+        goto err;
+
+    evq->wake = lsp_egroup_create();
+    if (evq->wake == NULL)
+        goto egroup_err;
+
+    evq->tail = 0;
+    evq->head = 0;
+    evq->sleeping = 0;
+    evq->mask = cap - 1;
+    lsp_spin_init(&evq->spin, 0);
+    // mark every slot as read on the previous lap
+    for (uint32_t i = 0; i < cap; ++i)
+        evq->slots[i].seq = i - cap;
+    return evq;
+
+egroup_err:
+    lsp_free(evq);
+err:
+    lsp_err(tag, "%s: could not create event queue of %u\n", __FUNCTION__, cap);
+    return NULL;
+}
+
+void lsp_evq_destroy(lsp_evq_t *evq)
+{
+    lsp_egroup_destroy(evq->wake);
+    lsp_free(evq);
+}
+
+int lsp_evq_push_burst(lsp_evq_t *evq, const lsp_evq_entry_t *entries, int n)
+{
+    uint32_t head, free, pos = __atomic_load_n(&evq->tail, __ATOMIC_RELAXED);
+    uint32_t now = lsp_gettime_us();
+    struct lsp_evq_slot *slot;
+    int count;
+
+    // reserve as many slots as fit, the consumer released everything before head
+    do
+    {
+        head = __atomic_load_n(&evq->head, __ATOMIC_ACQUIRE);
+        free = evq->mask + 1 - (pos - head);
+        if ((int32_t)free <= 0)
+            return 0;
+        count = (uint32_t)n < free ? n : (int)free;
+    } while (!__atomic_compare_exchange_n(&evq->tail, &pos, pos + count, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    for (int i = 0; i < count; ++i)
+    {
+        slot = &evq->slots[(pos + i) & evq->mask];
+        slot->entry = entries[i];
+        slot->entry.stamp = now;
+        __atomic_store_n(&slot->seq, pos + i + 1, __ATOMIC_RELEASE);
+    }
+
+    // pairs with the fence in lsp_evq_pop, wake only a consumer that is going to sleep
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&evq->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&evq->sleeping, 0, __ATOMIC_RELAXED))
+        lsp_egroup_set(evq->wake, EVQ_WAKE);
+    return count;
+}
+
+int lsp_evq_set_spin(lsp_evq_t *evq, uint32_t spin_us)
+{
+    if (spin_us > LSP_SPIN_MAX_US)
+        return LSP_ERR_INVALID;
+    lsp_spin_init(&evq->spin, spin_us);
+    return LSP_ERR_NONE;
+}
+
+void lsp_evq_getspin(lsp_evq_t *evq, lsp_spin_stats_t *stats)
+{
+    lsp_spin_stats_read(&evq->spin.stats, stats);
+}
+
+static int evq_ready(void *arg)
+{
+    lsp_evq_t *evq = arg;
+    uint32_t pos = evq->head;
+    return __atomic_load_n(&evq->slots[pos & evq->mask].seq, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+int lsp_evq_pop_burst(lsp_evq_t *evq, lsp_evq_entry_t *entries, int n, uint32_t timeout)
+{
+    int count, waited = 0, spun = 0;
+    uint32_t now, start = 0, pos = evq->head;
+    struct lsp_evq_slot *slot = &evq->slots[pos & evq->mask];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+    {
+        if (timeout == 0)
+            return 0;
+
+        waited = 1;
+        start = lsp_gettime_us();
+        spun = lsp_spin_wait(&evq->spin, evq_ready, evq);
+    }
+
+    if (waited && !spun)
+    {
+        // announce sleep, then check again so a concurrent push either is seen or wakes us
+        __atomic_store_n(&evq->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+            lsp_egroup_wait(evq->wake, EVQ_WAKE, 1, 0, timeout);
+        __atomic_store_n(&evq->sleeping, 0, __ATOMIC_RELAXED);
+    }
+
+    // stop at the first slot that is not published yet, its producer wakes us once it is
+    for (count = 0; count < n; ++count)
+    {
+        slot = &evq->slots[(pos + count) & evq->mask];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + count + 1)
+            break;
+        entries[count] = slot->entry;
+    }
+
+    if (count > 0)
+    {
+        __atomic_store_n(&evq->head, pos + count, __ATOMIC_RELEASE);
+        if (waited)
+        {
+            now = lsp_gettime_us();
+            lsp_spin_record(&evq->spin, now - start, now - entries[0].stamp, spun);
+        }
+    }
+    return count;
+}
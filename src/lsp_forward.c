@@ -0,0 +1,104 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_forward.h"
+#include "lsp_routing.h"
+#include "lsp_interface.h"
+#include "lsp_buffer.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+#if (LSP_FORWARDING_ENABLED)
+
+static const char *tag = "lsp_forward";
+
+/** slow path, copy packet to a buffer with enough headroom for egress */
+static lsp_buffer_t *forward_realloc(lsp_buffer_t *buff, lsp_interface_t *egress)
+{
+    size_t len = lsp_buffer_length(buff);
+    lsp_buffer_t *nbuff = lsp_buffer_alloc(egress, len);
+    if (nbuff != NULL)
+    {
+        memcpy(lsp_buffer_put(nbuff, len), buff->data, len);
+        nbuff->lsp_packet = (lsp_packet_t *)nbuff->data;
+        nbuff->priority = buff->priority;
+    }
+    lsp_buffer_free(buff);
+    return nbuff;
+}
+
+int lsp_forward(lsp_buffer_t *buff)
+{
+    int rc;
+    lsp_interface_t *ingress = buff->iface;
+    lsp_interface_t *egress;
+    lsp_packet_t *pkt = buff->lsp_packet;
+    size_t len = lsp_buffer_length(buff);
+
+    egress = lsp_route_select(pkt->dst_addr,
+                              lsp_flow_hash(pkt->src_addr, pkt->src_port, pkt->dst_addr, pkt->dst_port),
+                              len);
+    if (egress == NULL)
+    {
+        lsp_verb(tag, "%s: no route to %04X\n", __FUNCTION__, pkt->dst_addr);
+        rc = LSP_ERR_ADDR_NOTFOUND;
+        goto drop;
+    }
+
+    // all links are point-to-point, sending a packet back where it came from only
+    // bounces it between two nodes while their routes are stale or converging
+    if (egress == ingress)
+    {
+        lsp_verb(tag, "%s: %04X routes back to %s\n", __FUNCTION__, pkt->dst_addr, ingress->ifname);
+        rc = LSP_ERR_ADDR_NOTFOUND;
+        goto drop;
+    }
+
+    // driver pushes its link-layer header into the headroom freed by the ingress driver
+    if (buff->headroom < (size_t)egress->min_header_len)
+    {
+        buff = forward_realloc(buff, egress);
+        if (buff == NULL)
+        {
+            rc = LSP_ERR_NOMEM;
+            LSP_IF_STATS_INC(ingress, fwd_dropped);
+            return rc;
+        }
+    }
+
+    // never wait for tx_queue space, the caller may be the thread that drains it.
+    // Packets go out with the next batch drain of egress, see lsp_core_flush
+    rc = lsp_interface_xmit_timeout(egress, buff, 0);
+    if (rc != LSP_ERR_NONE)
+    {
+        LSP_IF_STATS_INC(ingress, fwd_dropped);
+        return rc;
+    }
+    LSP_IF_STATS_INC(egress, forwarded);
+    return LSP_ERR_NONE;
+
+drop:
+    LSP_IF_STATS_INC(ingress, fwd_dropped);
+    lsp_buffer_free(buff);
+    return rc;
+}
+
+#endif
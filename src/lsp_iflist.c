@@ -17,25 +17,190 @@
  *      Cedric Velandres, <ccvelandres@gmail.com>
  */
 
+#include "lsp.h"
 #include "lsp_iflist.h"
 #include "lsp_memory.h"
+#include "lsp_thread.h"
+#include "lsp_log.h"
 
 #include "string.h"
+#include "ctype.h"
+
+static const char *tag = "lsp_iflist";
+
+/** number of buckets in name hash table */
+#define IFLIST_HASH_SIZE 16
+
+/**
+ * Readers of each stats shard, counted per epoch parity. Readers enter the current epoch,
+ * synchronize flips the epoch and waits for the readers of the previous one to leave
+ */
+typedef struct iflist_readers_s
+{
+    uint32_t count[2];
+} __attribute__((aligned(64))) iflist_readers_t;
 
 static lsp_list_head_t iflist = LSP_LIST_HEAD_INIT(iflist);
+static lsp_interface_t *iftable[LSP_DEFAULT_IF_MAX];
+static lsp_interface_t *name_hash[IFLIST_HASH_SIZE];
+
+/** serializes writers, readers never take it */
+static lsp_mutex_t iflist_mutex;
+
+static iflist_readers_t iflist_readers[LSP_DEFAULT_IF_STATS_SHARDS];
+static uint32_t iflist_epoch;
+static __thread int read_depth;
+static __thread uint32_t read_parity;
+
+int lsp_iflist_init()
+{
+    int rc = lsp_mutex_init(&iflist_mutex);
+    if (rc != LSP_ERR_NONE)
+        return rc;
+
+    // iflist readers are counted per stats shard
+    rc = lsp_interface_shards_init();
+    if (rc != LSP_ERR_NONE)
+        lsp_mutex_destroy(&iflist_mutex);
+    return rc;
+}
+
+int lsp_iflist_free()
+{
+    lsp_interface_shards_free();
+    return lsp_mutex_destroy(&iflist_mutex);
+}
+
+static inline uint32_t iflist_hash_name(const char *name)
+{
+    // names are matched case insensitive
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(((lsp_interface_t *)0)->ifname) && name[i] != '\0'; ++i)
+        h = (h ^ (uint8_t)tolower((uint8_t)name[i])) * 16777619u;
+    return h % IFLIST_HASH_SIZE;
+}
+
+/** internal use only! removes iface from a hash chain linked through member at offset */
+static void iflist_unhash(lsp_interface_t **bucket, lsp_interface_t *iface, size_t offset)
+{
+    lsp_interface_t **pp = bucket;
+#define IFLIST_NEXT(ifp) ((lsp_interface_t **)((char *)(ifp) + offset))
+    while (*pp != NULL && *pp != iface)
+        pp = IFLIST_NEXT(*pp);
+    // removed entry keeps its next pointer so readers on it can continue
+    if (*pp == iface)
+        __atomic_store_n(pp, *IFLIST_NEXT(iface), __ATOMIC_RELEASE);
+#undef IFLIST_NEXT
+}
 
 int lsp_iflist_add(lsp_interface_t *iface)
 {
-    lsp_list_add(&iface->list, &iflist);
+    int index;
+    uint32_t h;
+
+    lsp_mutex_lock(&iflist_mutex, LSP_TIMEOUT_MAX);
+    if (lsp_iflist_iface_byname(iface->ifname) != NULL)
+    {
+        lsp_mutex_unlock(&iflist_mutex);
+        lsp_err(tag, "%s: %s already exists\n", __FUNCTION__, iface->ifname);
+        return LSP_ERR_RESOURCE_IN_USE;
+    }
+
+    for (index = 0; index < LSP_DEFAULT_IF_MAX && iftable[index] != NULL; ++index)
+        ;
+    if (index == LSP_DEFAULT_IF_MAX)
+    {
+        lsp_mutex_unlock(&iflist_mutex);
+        lsp_err(tag, "%s: no free index for %s\n", __FUNCTION__, iface->ifname);
+        return LSP_ERR_NOMEM;
+    }
+    iface->index = index;
+
+    // links of iface are set up before it is published to readers
+    h = iflist_hash_name(iface->ifname);
+    iface->name_next = name_hash[h];
+    __atomic_store_n(&name_hash[h], iface, __ATOMIC_RELEASE);
+
+    iface->list.next = &iflist;
+    iface->list.prev = iflist.prev;
+    __atomic_store_n(&iflist.prev->next, &iface->list, __ATOMIC_RELEASE);
+    iflist.prev = &iface->list;
+
+    __atomic_store_n(&iftable[index], iface, __ATOMIC_RELEASE);
+    lsp_mutex_unlock(&iflist_mutex);
+    return LSP_ERR_NONE;
+}
+
+int lsp_iflist_del(lsp_interface_t *iface)
+{
+    if (iface->index < 0 || iface->index >= LSP_DEFAULT_IF_MAX)
+        return LSP_ERR_INVALID;
+
+    lsp_mutex_lock(&iflist_mutex, LSP_TIMEOUT_MAX);
+    if (iftable[iface->index] != iface)
+    {
+        lsp_mutex_unlock(&iflist_mutex);
+        return LSP_ERR_INVALID;
+    }
+
+    __atomic_store_n(&iftable[iface->index], NULL, __ATOMIC_RELEASE);
+    iflist_unhash(&name_hash[iflist_hash_name(iface->ifname)], iface, offsetof(lsp_interface_t, name_next));
+    // iface->list.next stays intact for readers still on iface
+    __atomic_store_n(&iface->list.prev->next, iface->list.next, __ATOMIC_RELEASE);
+    iface->list.next->prev = iface->list.prev;
+    lsp_mutex_unlock(&iflist_mutex);
     return LSP_ERR_NONE;
 }
 
+void lsp_iflist_read_lock()
+{
+    iflist_readers_t *readers;
+    uint32_t parity;
+
+    if (read_depth++ > 0)
+        return;
+
+    readers = &iflist_readers[lsp_interface_shard_id >= 0 ? lsp_interface_shard_id : lsp_interface_shard_init()];
+    for (;;)
+    {
+        parity = __atomic_load_n(&iflist_epoch, __ATOMIC_SEQ_CST) & 1;
+        __atomic_add_fetch(&readers->count[parity], 1, __ATOMIC_SEQ_CST);
+        // epoch flipped before we were counted, synchronize may not have seen us
+        if ((__atomic_load_n(&iflist_epoch, __ATOMIC_SEQ_CST) & 1) == parity)
+            break;
+        __atomic_sub_fetch(&readers->count[parity], 1, __ATOMIC_SEQ_CST);
+    }
+    read_parity = parity;
+}
+
+void lsp_iflist_read_unlock()
+{
+    if (--read_depth > 0)
+        return;
+    __atomic_sub_fetch(&iflist_readers[lsp_interface_shard_id].count[read_parity], 1, __ATOMIC_RELEASE);
+}
+
+void lsp_iflist_synchronize()
+{
+    uint32_t parity;
+
+    // one grace period at a time so both epochs are never waited on at once
+    lsp_mutex_lock(&iflist_mutex, LSP_TIMEOUT_MAX);
+    parity = __atomic_fetch_add(&iflist_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    for (int i = 0; i < LSP_DEFAULT_IF_STATS_SHARDS; ++i)
+    {
+        while (__atomic_load_n(&iflist_readers[i].count[parity], __ATOMIC_ACQUIRE) != 0)
+            lsp_thread_sleep(1);
+    }
+    lsp_mutex_unlock(&iflist_mutex);
+}
+
 lsp_interface_t *lsp_iflist_iface_byname(const char *name)
 {
-    lsp_interface_t *iface;
-    lsp_list_for(iface, list, &iflist)
+    lsp_interface_t *iface = __atomic_load_n(&name_hash[iflist_hash_name(name)], __ATOMIC_ACQUIRE);
+    for (; iface != NULL; iface = __atomic_load_n(&iface->name_next, __ATOMIC_ACQUIRE))
     {
-        if(strncasecmp(name, iface->ifname, sizeof(iface->ifname)) == 0)
+        if (strncasecmp(name, iface->ifname, sizeof(iface->ifname)) == 0)
             return iface;
     }
     return NULL;
@@ -44,9 +209,28 @@ lsp_interface_t *lsp_iflist_iface_byname(const char *name)
 lsp_interface_t *lsp_iflist_iface_byaddr(const lsp_addr_t addr)
 {
     lsp_interface_t *iface;
-    lsp_list_for(iface, list, &iflist)
+
+    // every interface carries the system address, hashing it would put them all in one bucket
+    for (int i = 0; i < LSP_DEFAULT_IF_MAX; ++i)
     {
-        if(addr == iface->dev_addr) return iface;
+        iface = __atomic_load_n(&iftable[i], __ATOMIC_ACQUIRE);
+        if (iface != NULL && addr == iface->dev_addr)
+            return iface;
     }
     return NULL;
 }
+
+lsp_interface_t *lsp_iflist_iface_byindex(int index)
+{
+    if (index < 0 || index >= LSP_DEFAULT_IF_MAX)
+        return NULL;
+    return __atomic_load_n(&iftable[index], __ATOMIC_ACQUIRE);
+}
+
+lsp_interface_t *lsp_iflist_next(lsp_interface_t *iface)
+{
+    lsp_list_t *next = __atomic_load_n(iface == NULL ? &iflist.next : &iface->list.next, __ATOMIC_ACQUIRE);
+    if (next == &iflist)
+        return NULL;
+    return container_of(next, lsp_interface_t, list);
+}
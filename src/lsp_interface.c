@@ -17,46 +17,227 @@
  *      Cedric Velandres, <ccvelandres@gmail.com>
  */
 
+#include "lsp.h"
 #include "lsp_interface.h"
+#include "lsp_iflist.h"
+#include "lsp_routing.h"
+#include "lsp_buffer.h"
+#include "lsp_core.h"
+#include "lsp_link.h"
+#include "lsp_time.h"
+#include "lsp_thread.h"
+#include "lsp_egroup.h"
 #include "lsp_memory.h"
 #include "lsp_log.h"
 
 #include "stdarg.h"
 #include "stdio.h"
+#include "string.h"
 
 static const char *tag = "lsp_interface";
 
+/** wakes a tx worker to drain tx_queue */
+#define TXWORKER_WAKE (1 << 0)
+
+struct lsp_interface_txworker_s
+{
+    lsp_thread_handle_t thread; /** worker thread */
+    lsp_egroup_handle_t wake;   /** TXWORKER_WAKE is set on every kick */
+    volatile int running;       /** cleared to stop the worker */
+};
+
+#if (LSP_DEFAULT_IF_STATS_SHARDS > 64)
+#error "LSP_DEFAULT_IF_STATS_SHARDS must not exceed 64"
+#endif
+
+/** last shard is shared by the threads that find no free shard */
+#define SHARD_SHARED (LSP_DEFAULT_IF_STATS_SHARDS - 1)
+
+__thread int lsp_interface_shard_id = -1;
+
+/** bit n is set while shard n is owned by a thread */
+static uint64_t shard_used;
+/** holds shard id + 1 of each owning thread, its destructor gives the shard back */
+static lsp_thread_key_t shard_key;
+static int shard_key_valid;
+
 lsp_interface_t *lsp_interface_alloc(int tx_queuelen, size_t priv_len, const char *fmt, ...)
 {
     int rc = -LSP_ERR_NOMEM;
     lsp_interface_t *iface = lsp_calloc(1, sizeof(lsp_interface_t) + priv_len);
     if(iface == NULL) goto err;
 
-    iface->tx_queue = lsp_queue_create(tx_queuelen);
+    iface->tx_queue = lsp_queue_create(tx_queuelen, sizeof(lsp_buffer_t *));
     if(iface->tx_queue == NULL) goto txq_err;
+    if(priv_len > 0) iface->interface_data = iface + 1;
+    iface->tx_inflight_max = LSP_DEFAULT_IF_TX_INFLIGHT;
 
     va_list args;
     va_start(args, fmt);
     rc = vsnprintf(iface->ifname, sizeof(iface->ifname), fmt, args);
     va_end(args);
-    if(!(rc > 0 && rc < sizeof(iface->ifname)))
+    if(!(rc > 0 && (size_t)rc < sizeof(iface->ifname)))
         lsp_warn(tag, "interface name might not be registered correctly: %s\n", iface->ifname);
 
     return iface;
 
 rxq_err:
-    lsp_free(iface->tx_queue);
+    lsp_queue_destroy(iface->tx_queue);
 txq_err:
     lsp_free(iface);
 err:
-    return rc;
+    return NULL;
+}
+
+void lsp_interface_free(lsp_interface_t *iface)
+{
+    lsp_queue_destroy(iface->tx_queue);
+    lsp_free(iface);
 }
 
 int lsp_interface_register(lsp_interface_t *iface)
 {
+    int rc;
+
+    iface->dev_addr = lsp_conf->addr;
+
+    if (iface->ops->open != NULL)
+    {
+        rc = iface->ops->open(iface);
+        if (rc != LSP_ERR_NONE)
+        {
+            lsp_err(tag, "%s: could not open %s %d\n", __FUNCTION__, iface->ifname, rc);
+            return rc;
+        }
+    }
+
+    rc = lsp_iflist_add(iface);
+    if (rc != LSP_ERR_NONE)
+    {
+        // table full or name taken, stop the driver before the caller frees iface
+        lsp_err(tag, "%s: could not add %s %d\n", __FUNCTION__, iface->ifname, rc);
+        if (iface->ops->close != NULL)
+            iface->ops->close(iface);
+        return rc;
+    }
+
+    if (lsp_conf->tx_workers &&
+        lsp_interface_txworker_start(iface, lsp_conf->tx_cpus) != LSP_ERR_NONE)
+        lsp_warn(tag, "%s: %s is drained by core\n", __FUNCTION__, iface->ifname);
+    return rc;
+}
+
+
+/** thread exit, counters stay in the shard for the next owner to add to */
+static void shard_release(void *value)
+{
+    int id = (intptr_t)value - 1;
+
+    lsp_interface_shard_id = -1;
+    __atomic_fetch_and(&shard_used, ~((uint64_t)1 << id), __ATOMIC_RELEASE);
+}
+
+int lsp_interface_shards_init()
+{
+    int rc = lsp_thread_key_create(&shard_key, shard_release);
+    if (rc == LSP_ERR_NONE)
+        __atomic_store_n(&shard_key_valid, 1, __ATOMIC_RELEASE);
+    return rc;
+}
+
+void lsp_interface_shards_free()
+{
+    if (__atomic_exchange_n(&shard_key_valid, 0, __ATOMIC_ACQ_REL))
+        lsp_thread_key_delete(shard_key);
+}
+
+int lsp_interface_shard_init()
+{
+    int id;
+    uint64_t used = __atomic_load_n(&shard_used, __ATOMIC_RELAXED);
+
+    // without a key shards could not be given back, every thread shares the last one
+    if (!__atomic_load_n(&shard_key_valid, __ATOMIC_ACQUIRE))
+        return lsp_interface_shard_id = SHARD_SHARED;
+
+    do
+    {
+        id = ~used ? __builtin_ctzll(~used) : SHARD_SHARED;
+        if (id >= SHARD_SHARED)
+            return lsp_interface_shard_id = SHARD_SHARED;
+    } while (!__atomic_compare_exchange_n(&shard_used, &used, used | ((uint64_t)1 << id), 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    if (lsp_thread_key_set(shard_key, (void *)(intptr_t)(id + 1)) != LSP_ERR_NONE)
+    {
+        __atomic_fetch_and(&shard_used, ~((uint64_t)1 << id), __ATOMIC_RELEASE);
+        id = SHARD_SHARED;
+    }
+    return lsp_interface_shard_id = id;
+}
+
+void lsp_interface_stats_snapshot(lsp_interface_t *iface, lsp_interface_stats_t *stats)
+{
+    lsp_interface_stats_t copy;
+    lsp_interface_shard_t *shard;
+    uint64_t *sum = (uint64_t *)stats;
+    const uint64_t *val = (const uint64_t *)&copy;
+    uint32_t seq;
+
+    memset(stats, 0, sizeof(*stats));
+    for (int s = 0; s < LSP_DEFAULT_IF_STATS_SHARDS; ++s)
+    {
+        shard = &iface->stats[s];
+        do
+        {
+            while ((seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE)) & 1)
+                ;
+            memcpy(&copy, &shard->stats, sizeof(copy));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        } while (seq != __atomic_load_n(&shard->seq, __ATOMIC_RELAXED));
 
+        // every counter is a uint64_t, sum them as an array
+        for (size_t i = 0; i < sizeof(copy) / sizeof(uint64_t); ++i)
+            sum[i] += val[i];
+    }
 }
 
+int lsp_interface_unregister(lsp_interface_t *iface)
+{
+    int rc;
+    lsp_buffer_t *buff;
+
+    rc = lsp_iflist_del(iface);
+    if (rc != LSP_ERR_NONE)
+        return rc;
+
+    // packets to and from iface are dropped from here on, routes stop resolving to it
+    __atomic_store_n(&iface->removed, 1, __ATOMIC_SEQ_CST);
+    lsp_route_flush_iface(iface);
+    lsp_interface_txworker_stop(iface);
+    // drains that did not see removed are within a read section
+    lsp_iflist_synchronize();
+
+    // events queued to core before the grace period still reference iface
+    lsp_core_barrier();
+
+    if (iface->ops->close != NULL)
+        iface->ops->close(iface);
+
+    // asynchronous drivers still own buffers that complete on iface,
+    // received buffers lent by the driver may still sit in socket queues
+    while (__atomic_load_n(&iface->tx_inflight, __ATOMIC_ACQUIRE) > 0 ||
+           __atomic_load_n(&iface->rx_loans, __ATOMIC_ACQUIRE) > 0)
+        lsp_thread_sleep(1);
+    lsp_iflist_synchronize();
+
+    while (lsp_queue_pop(iface->tx_queue, &buff, 0) == LSP_ERR_NONE)
+        lsp_buffer_free(buff);
+
+    lsp_verb(tag, "%s: %s removed\n", __FUNCTION__, iface->ifname);
+    lsp_interface_free(iface);
+    return LSP_ERR_NONE;
+}
 
 void *lsp_interface_getdata(lsp_interface_t *iface)
 {
@@ -65,5 +246,472 @@ void *lsp_interface_getdata(lsp_interface_t *iface)
 
 int lsp_interface_qwrite(lsp_interface_t *iface, void *data, size_t len, int flags)
 {
-    
-}
\ No newline at end of file
+    lsp_buffer_t *buff;
+    (void)flags; // unused
+
+    buff = lsp_buffer_alloc(iface, len);
+    if (buff == NULL)
+    {
+        LSP_IF_STATS_INC(iface, dropped);
+        return LSP_ERR_NOMEM;
+    }
+    memcpy(lsp_buffer_put(buff, len), data, len);
+
+    return lsp_interface_rx_burst(iface, &buff, 1) == 1 ? LSP_ERR_NONE : LSP_ERR_QUEUE_FULL;
+}
+
+int lsp_interface_rx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    int i, j, chunk, queued, accepted = 0, inline_count = 0;
+    uint64_t bytes = 0;
+    size_t len;
+    lsp_interface_stats_t *st;
+
+    // unregister waits for this section, nothing is queued to core once removed is set
+    lsp_iflist_read_lock();
+    if (__atomic_load_n(&iface->removed, __ATOMIC_ACQUIRE))
+    {
+        for (j = 0; j < n; ++j)
+            lsp_buffer_free(bufs[j]);
+        LSP_IF_STATS_ADD(iface, dropped, n);
+        lsp_iflist_read_unlock();
+        return 0;
+    }
+
+    // run to completion, only control traffic is queued to core
+    if (__atomic_load_n(&iface->flags, __ATOMIC_RELAXED) & LSP_IF_FLAGS_RX_INLINE)
+    {
+        for (j = 0; j < n; ++j)
+        {
+            bufs[j]->iface = iface;
+            len = lsp_buffer_length(bufs[j]);
+            if (lsp_core_input(bufs[j]) != LSP_ERR_NONE)
+            {
+                lsp_buffer_free(bufs[j]);
+                continue;
+            }
+            bytes += len;
+            accepted++;
+        }
+        // dropped buffers are counted in dropped and evq_full only
+        inline_count = accepted;
+        goto stats;
+    }
+
+    for (i = 0; i < n; i += chunk)
+    {
+        chunk = n - i < LSP_DEFAULT_IF_RX_BURST ? n - i : LSP_DEFAULT_IF_RX_BURST;
+
+        // buffers belong to core once queued, count bytes beforehand
+        for (j = i; j < i + chunk; ++j)
+        {
+            bufs[j]->iface = iface;
+            bytes += lsp_buffer_length(bufs[j]);
+        }
+
+        queued = lsp_core_sendevent_burst(LSP_EV_NET_RX_EVENT, (void **)&bufs[i], chunk);
+        for (j = i + queued; j < i + chunk; ++j)
+            bytes -= lsp_buffer_length(bufs[j]);
+        accepted += queued;
+
+        // evqueue is full, drop the rest of the batch
+        if (queued < chunk)
+        {
+            for (j = i + queued; j < n; ++j)
+                lsp_buffer_free(bufs[j]);
+            break;
+        }
+    }
+
+stats:
+    st = lsp_interface_stats_begin(iface);
+    st->rx_count += accepted;
+    st->rx_bytes += bytes;
+    st->dropped += n - accepted;
+    st->evq_full += n - accepted;
+    st->rx_inline += inline_count;
+    if (n > 0)
+        st->rx_burst_hist[lsp_interface_burst_bin(n)]++;
+    lsp_interface_stats_end(iface, st);
+    lsp_iflist_read_unlock();
+    return accepted;
+}
+
+/** schedules a drain of tx_queue on the tx worker or core */
+static inline void interface_tx_kick(lsp_interface_t *iface)
+{
+    lsp_interface_txworker_t *worker;
+
+    // removed interfaces are not drained anymore, worker is freed after a grace period
+    lsp_iflist_read_lock();
+    if (__atomic_load_n(&iface->removed, __ATOMIC_ACQUIRE))
+        goto end;
+
+    // wake only once per drain, packets stay queued for the next drain if evqueue is full
+    if (__atomic_exchange_n(&iface->tx_pending, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        worker = __atomic_load_n(&iface->tx_worker, __ATOMIC_ACQUIRE);
+        if (worker != NULL)
+            lsp_egroup_set(worker->wake, TXWORKER_WAKE);
+        else if (lsp_core_sendevent(LSP_EV_NET_TX_EVENT, iface) != LSP_ERR_NONE)
+            __atomic_store_n(&iface->tx_pending, 0, __ATOMIC_RELEASE);
+    }
+end:
+    lsp_iflist_read_unlock();
+}
+
+void lsp_interface_set_rx_inline(lsp_interface_t *iface, int enable)
+{
+    if (enable)
+        __atomic_fetch_or(&iface->flags, LSP_IF_FLAGS_RX_INLINE, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&iface->flags, ~LSP_IF_FLAGS_RX_INLINE, __ATOMIC_RELAXED);
+}
+
+int lsp_interface_xmit(lsp_interface_t *iface, lsp_buffer_t *buff)
+{
+    return lsp_interface_xmit_timeout(iface, buff, LSP_DEFAULT_IF_TXQUEUE_TIMEOUT_MS);
+}
+
+int lsp_interface_xmit_timeout(lsp_interface_t *iface, lsp_buffer_t *buff, uint32_t timeout)
+{
+    int rc;
+    lsp_interface_stats_t *st;
+
+    buff->iface = iface;
+    if (__atomic_load_n(&iface->removed, __ATOMIC_ACQUIRE))
+    {
+        LSP_IF_STATS_INC(iface, dropped);
+        lsp_buffer_free(buff);
+        return LSP_ERR_ADDR_NOTFOUND;
+    }
+
+    rc = lsp_queue_push(iface->tx_queue, &buff, timeout);
+    if (rc != LSP_ERR_NONE)
+    {
+        lsp_verb(tag, "%s: %s tx_queue full, dropping packet\n", __FUNCTION__, iface->ifname);
+        st = lsp_interface_stats_begin(iface);
+        st->dropped++;
+        st->txq_full++;
+        lsp_interface_stats_end(iface, st);
+        lsp_buffer_free(buff);
+        return rc;
+    }
+
+    interface_tx_kick(iface);
+    return LSP_ERR_NONE;
+}
+
+/** burst lengths and priorities, captured before the driver call since asynchronous drivers may free buffers */
+struct interface_tx_meta
+{
+    uint32_t len[LSP_DEFAULT_IF_TX_BURST];
+    uint8_t prio[LSP_DEFAULT_IF_TX_BURST];
+};
+
+static inline void interface_tx_meta(struct interface_tx_meta *meta, lsp_buffer_t **bufs, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        meta->len[i] = lsp_buffer_length(bufs[i]);
+        meta->prio[i] = bufs[i]->priority < LSP_IF_STATS_PRIOS ? bufs[i]->priority : LSP_CONN_PRIO_MAX;
+    }
+}
+
+/** updates tx stats once per burst, driver calls are made outside of the stats update */
+static size_t interface_tx_account(lsp_interface_t *iface, const struct interface_tx_meta *meta, int n, const uint8_t *sent)
+{
+    lsp_interface_stats_t *st = lsp_interface_stats_begin(iface);
+    size_t bytes = 0;
+
+    st->tx_burst_hist[lsp_interface_burst_bin(n)]++;
+    for (int i = 0; i < n; ++i)
+    {
+        if (!sent[i])
+        {
+            st->tx_error++;
+            continue;
+        }
+        bytes += meta->len[i];
+        st->tx_count++;
+        st->tx_bytes += meta->len[i];
+        st->tx_prio_bytes[meta->prio[i]] += meta->len[i];
+    }
+    lsp_interface_stats_end(iface, st);
+    return bytes;
+}
+
+static int interface_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n, uint8_t *sent)
+{
+    int count = iface->ops->tx_burst(iface, bufs, n);
+    if (count < 0)
+        count = 0;
+
+    // driver sends in order, anything after count has failed
+    for (int i = 0; i < n; ++i)
+        sent[i] = (i < count);
+    return count;
+}
+
+static int interface_tx_single(lsp_interface_t *iface, lsp_buffer_t **bufs, int n, uint8_t *sent)
+{
+    int rc, count = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        rc = iface->ops->tx(iface, bufs[i]->data, lsp_buffer_length(bufs[i]));
+        sent[i] = (rc == LSP_ERR_NONE);
+        if (rc != LSP_ERR_NONE)
+        {
+            lsp_verb(tag, "%s: %s tx error %d\n", __FUNCTION__, iface->ifname, rc);
+            continue;
+        }
+        count++;
+    }
+    return count;
+}
+
+/** returns 1 if drain has to stop until completions release in-flight space */
+static int interface_tx_backpressure(lsp_interface_t *iface)
+{
+    __atomic_store_n(&iface->tx_blocked, 1, __ATOMIC_SEQ_CST);
+    // a completion between the limit check and setting tx_blocked would not wake us
+    if (__atomic_load_n(&iface->tx_inflight, __ATOMIC_SEQ_CST) < iface->tx_inflight_max &&
+        __atomic_exchange_n(&iface->tx_blocked, 0, __ATOMIC_SEQ_CST))
+        return 0;
+
+    LSP_IF_STATS_INC(iface, tx_inflight_full);
+    return 1;
+}
+
+/** hands a burst to an asynchronous driver, accepted buffers are owned by the driver until completion */
+static int interface_tx_async(lsp_interface_t *iface, lsp_buffer_t **bufs, int n, uint8_t *sent)
+{
+    int count;
+    uint32_t now = lsp_gettime_us();
+
+    for (int i = 0; i < n; ++i)
+        bufs[i]->tx_time = now;
+
+    // accounted before the call, the driver may complete before returning
+    __atomic_add_fetch(&iface->tx_inflight, n, __ATOMIC_SEQ_CST);
+    count = interface_tx_burst(iface, bufs, n, sent);
+    __atomic_sub_fetch(&iface->tx_inflight, n - count, __ATOMIC_SEQ_CST);
+    return count;
+}
+
+static int interface_txq_drain_locked(lsp_interface_t *iface)
+{
+    int n, budget, inflight, count = 0;
+    int async = (__atomic_load_n(&iface->flags, __ATOMIC_RELAXED) & LSP_IF_FLAGS_TX_ASYNC) && iface->ops->tx_burst != NULL;
+    lsp_buffer_t *bufs[LSP_DEFAULT_IF_TX_BURST];
+    uint8_t sent[LSP_DEFAULT_IF_TX_BURST];
+    struct interface_tx_meta meta;
+    uint32_t start;
+    size_t bytes;
+
+    // driver may be closed already, leftovers are freed by unregister
+    if (__atomic_load_n(&iface->removed, __ATOMIC_ACQUIRE))
+        return 0;
+
+    // cleared before popping so buffers queued during the drain raise a new event
+    __atomic_store_n(&iface->tx_pending, 0, __ATOMIC_RELEASE);
+    for (;;)
+    {
+        budget = LSP_DEFAULT_IF_TX_BURST;
+        if (async)
+        {
+            inflight = __atomic_load_n(&iface->tx_inflight, __ATOMIC_SEQ_CST);
+            if (inflight >= iface->tx_inflight_max)
+            {
+                if (interface_tx_backpressure(iface))
+                    break;
+                continue;
+            }
+            if (iface->tx_inflight_max - inflight < budget)
+                budget = iface->tx_inflight_max - inflight;
+        }
+
+        n = lsp_queue_pop_burst(iface->tx_queue, bufs, budget, 0);
+        if (n <= 0)
+            break;
+        interface_tx_meta(&meta, bufs, n);
+
+        if (async)
+        {
+            count += interface_tx_async(iface, bufs, n, sent);
+            interface_tx_account(iface, &meta, n, sent);
+            // accepted buffers are returned through lsp_interface_tx_complete
+            for (int i = 0; i < n; ++i)
+                if (!sent[i])
+                    lsp_buffer_free(bufs[i]);
+            continue;
+        }
+
+        start = lsp_gettime_us();
+        if (iface->ops->tx_burst != NULL)
+            count += interface_tx_burst(iface, bufs, n, sent);
+        else
+            count += interface_tx_single(iface, bufs, n, sent);
+
+        bytes = interface_tx_account(iface, &meta, n, sent);
+#if (LSP_LINK_EST_ENABLED)
+        // time until the driver returns is the completion time of the burst
+        lsp_link_tx_sample(iface, bytes, lsp_gettime_us() - start);
+#endif
+        for (int i = 0; i < n; ++i)
+            lsp_buffer_free(bufs[i]);
+    }
+
+    return count;
+}
+
+/** drains tx_queue, only one thread at a time calls the driver */
+static int interface_txq_drain(lsp_interface_t *iface)
+{
+    int count = 0;
+
+    do
+    {
+        while (__atomic_exchange_n(&iface->tx_draining, 1, __ATOMIC_SEQ_CST))
+        {
+            // owner rechecks tx_drain_missed after releasing, unless it already left
+            __atomic_store_n(&iface->tx_drain_missed, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&iface->tx_draining, __ATOMIC_SEQ_CST))
+                return count;
+        }
+
+        // drains run on core, tx workers and senders, the read section keeps unregister
+        // from closing the driver (and veth from freeing the peer) under a burst in progress
+        lsp_iflist_read_lock();
+        count += interface_txq_drain_locked(iface);
+        lsp_iflist_read_unlock();
+        __atomic_store_n(&iface->tx_draining, 0, __ATOMIC_SEQ_CST);
+    } while (__atomic_exchange_n(&iface->tx_drain_missed, 0, __ATOMIC_SEQ_CST));
+
+    return count;
+}
+
+int lsp_interface_txq_drain(lsp_interface_t *iface)
+{
+    lsp_interface_txworker_t *worker;
+
+    // event was queued before the worker started, the worker owns the driver now
+    lsp_iflist_read_lock();
+    worker = __atomic_load_n(&iface->tx_worker, __ATOMIC_ACQUIRE);
+    if (worker != NULL)
+        lsp_egroup_set(worker->wake, TXWORKER_WAKE);
+    lsp_iflist_read_unlock();
+
+    return worker == NULL ? interface_txq_drain(iface) : 0;
+}
+
+static lsp_thread_return_t interface_txworker_task(void *arg)
+{
+    lsp_interface_t *iface = arg;
+    lsp_interface_txworker_t *worker = iface->tx_worker;
+
+    while (__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE))
+    {
+        // timeout only so that stop is noticed even if the wake is lost
+        lsp_egroup_wait(worker->wake, TXWORKER_WAKE, 1, 0, LSP_DEFAULT_CORE_MAX_SLEEP_MS);
+        interface_txq_drain(iface);
+    }
+    return (lsp_thread_return_t)0;
+}
+
+int lsp_interface_txworker_start(lsp_interface_t *iface, lsp_cpumask_t cpus)
+{
+    int rc = LSP_ERR_NOMEM;
+    lsp_interface_txworker_t *worker;
+
+    if (iface->tx_worker != NULL)
+        return LSP_ERR_RESOURCE_IN_USE;
+
+    worker = lsp_malloc(sizeof(lsp_interface_txworker_t));
+    if (worker == NULL)
+        goto err;
+
+    worker->wake = lsp_egroup_create();
+    if (worker->wake == NULL)
+        goto egroup_err;
+
+    worker->running = 1;
+    __atomic_store_n(&iface->tx_worker, worker, __ATOMIC_RELEASE);
+    rc = lsp_thread_create(interface_txworker_task, iface->ifname, LSP_DEFAULT_CORE_STACK_SIZE,
+                           iface, LSP_DEFAULT_CORE_PRIORITY, &worker->thread);
+    if (rc != LSP_ERR_NONE)
+        goto thread_err;
+
+    if (lsp_thread_setaffinity(worker->thread, cpus) != LSP_ERR_NONE)
+        lsp_warn(tag, "%s: could not pin %s tx worker to %llx\n", __FUNCTION__, iface->ifname, (unsigned long long)cpus);
+
+    // pick up anything queued before the worker existed
+    lsp_egroup_set(worker->wake, TXWORKER_WAKE);
+    return LSP_ERR_NONE;
+
+thread_err:
+    __atomic_store_n(&iface->tx_worker, NULL, __ATOMIC_RELEASE);
+    lsp_egroup_destroy(worker->wake);
+egroup_err:
+    lsp_free(worker);
+err:
+    lsp_err(tag, "%s: could not start %s tx worker %d\n", __FUNCTION__, iface->ifname, rc);
+    return rc;
+}
+
+void lsp_interface_txworker_stop(lsp_interface_t *iface)
+{
+    lsp_interface_txworker_t *worker = iface->tx_worker;
+
+    if (worker == NULL)
+        return;
+
+    // kicks that still see the worker finish within the grace period
+    __atomic_store_n(&iface->tx_worker, NULL, __ATOMIC_RELEASE);
+    lsp_iflist_synchronize();
+    __atomic_store_n(&worker->running, 0, __ATOMIC_RELEASE);
+    lsp_egroup_set(worker->wake, TXWORKER_WAKE);
+    lsp_thread_join(worker->thread);
+    lsp_egroup_destroy(worker->wake);
+    lsp_free(worker);
+
+    // leftovers are drained by core from now on
+    __atomic_store_n(&iface->tx_pending, 0, __ATOMIC_RELEASE);
+    interface_tx_kick(iface);
+}
+
+void lsp_interface_tx_complete(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    size_t bytes = 0;
+
+    // nothing completed, bufs[0] is not valid
+    if (n <= 0)
+        return;
+
+    // unregister frees iface once tx_inflight dropped to 0 and this section ended
+    lsp_iflist_read_lock();
+#if (LSP_LINK_EST_ENABLED)
+    uint32_t now = lsp_gettime_us();
+    uint32_t last = __atomic_load_n(&iface->link.last_complete, __ATOMIC_RELAXED);
+    // link was busy since the later of the oldest submission and the previous completion
+    uint32_t start = (int32_t)(bufs[0]->tx_time - last) > 0 ? bufs[0]->tx_time : last;
+#endif
+
+    for (int i = 0; i < n; ++i)
+    {
+        bytes += lsp_buffer_length(bufs[i]);
+        lsp_buffer_free(bufs[i]);
+    }
+
+#if (LSP_LINK_EST_ENABLED)
+    lsp_link_tx_sample(iface, bytes, now - start);
+    __atomic_store_n(&iface->link.last_complete, now, __ATOMIC_RELAXED);
+#endif
+
+    __atomic_sub_fetch(&iface->tx_inflight, n, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&iface->tx_blocked, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&iface->tx_blocked, 0, __ATOMIC_SEQ_CST))
+        interface_tx_kick(iface);
+    lsp_iflist_read_unlock();
+}
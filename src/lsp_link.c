@@ -0,0 +1,181 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_link.h"
+#include "lsp_routing.h"
+#include "lsp_iflist.h"
+#include "lsp_buffer.h"
+#include "lsp_time.h"
+#include "lsp_timer.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+#if (LSP_LINK_EST_ENABLED)
+
+static const char *tag = "lsp_link";
+
+/** largest linkspeed estimate, -1 means unknown to routing */
+#define LINK_SPEED_MAX ((uint32_t)-2)
+
+static lsp_timer_t est_timer;
+#if (LSP_DEFAULT_LINK_PROBE_MS > 0)
+static lsp_timer_t probe_timer;
+#endif
+
+static inline uint32_t link_ewma(uint32_t avg, uint32_t sample)
+{
+    if (avg == 0)
+        return sample;
+    return (uint32_t)((int64_t)avg + ((int64_t)sample - avg) / (1 << LSP_DEFAULT_LINK_EWMA_SHIFT));
+}
+
+static void link_estimate(lsp_interface_t *iface)
+{
+    lsp_link_est_t *est = &iface->link;
+    uint64_t bytes = __atomic_exchange_n(&est->busy_bytes, 0, __ATOMIC_RELAXED);
+    uint32_t us = __atomic_exchange_n(&est->busy_us, 0, __ATOMIC_RELAXED);
+    uint64_t sample;
+    uint32_t delta;
+
+    // small windows are dominated by timer resolution, keep accumulating
+    if (bytes < LSP_DEFAULT_LINK_EST_MIN_BYTES)
+    {
+        lsp_link_tx_sample(iface, bytes, us);
+        return;
+    }
+
+    sample = bytes * 1000000 / (us > 0 ? us : 1);
+    est->linkspeed = link_ewma(est->linkspeed, sample < LINK_SPEED_MAX ? sample : LINK_SPEED_MAX);
+
+    // apply only significant changes so routes are not readvertised on every sample
+    delta = est->linkspeed > est->reported ? est->linkspeed - est->reported : est->reported - est->linkspeed;
+    if (est->reported == 0 || delta > (est->reported >> LSP_DEFAULT_LINK_EWMA_SHIFT))
+    {
+        lsp_verb(tag, "%s: %s linkspeed %u bytes/s\n", __FUNCTION__, iface->ifname, est->linkspeed);
+        est->reported = est->linkspeed;
+        lsp_route_set_linkspeed(iface, est->linkspeed);
+    }
+}
+
+static int link_send(lsp_interface_t *iface, lsp_addr_t dst, uint8_t type, uint32_t timestamp)
+{
+    lsp_packet_t *pkt;
+    lsp_link_probe_t *probe;
+    lsp_buffer_t *buff = lsp_buffer_alloc(iface, sizeof(lsp_packet_t) + sizeof(lsp_link_probe_t));
+    if (buff == NULL)
+        return LSP_ERR_NOMEM;
+
+    pkt = lsp_buffer_put(buff, sizeof(lsp_packet_t));
+    memset(pkt, 0, sizeof(lsp_packet_t));
+    pkt->dst_addr = dst;
+    pkt->src_addr = lsp_conf->addr;
+    pkt->src_port = LSP_SP_PING;
+    pkt->dst_port = LSP_SP_PING;
+    pkt->plen = sizeof(lsp_link_probe_t);
+
+    probe = lsp_buffer_put(buff, sizeof(lsp_link_probe_t));
+    probe->type = type;
+    probe->reserved = 0;
+    probe->timestamp = timestamp;
+    buff->priority = LSP_CONN_PRIO_MAX;
+
+    return lsp_interface_xmit(iface, buff);
+}
+
+static void link_est_timer(lsp_timer_t *timer, void *arg)
+{
+    lsp_interface_t *iface;
+    (void)arg; // unused
+
+    for (iface = lsp_iflist_next(NULL); iface != NULL; iface = lsp_iflist_next(iface))
+        link_estimate(iface);
+    lsp_timer_arm(timer, LSP_DEFAULT_LINK_EST_MS);
+}
+
+#if (LSP_DEFAULT_LINK_PROBE_MS > 0)
+static void link_probe_timer(lsp_timer_t *timer, void *arg)
+{
+    lsp_interface_t *iface;
+    (void)arg; // unused
+
+    // any node on the link answers, replies are matched by the interface they arrive on
+    for (iface = lsp_iflist_next(NULL); iface != NULL; iface = lsp_iflist_next(iface))
+        link_send(iface, LSP_ADDR_ANY, LINK_PROBE_REQUEST, lsp_gettime_us());
+    lsp_timer_arm(timer, LSP_DEFAULT_LINK_PROBE_MS);
+}
+#endif
+
+int lsp_link_start()
+{
+    lsp_timer_init(&est_timer, link_est_timer, NULL);
+    lsp_timer_arm(&est_timer, LSP_DEFAULT_LINK_EST_MS);
+#if (LSP_DEFAULT_LINK_PROBE_MS > 0)
+    // first probe right away so that rtt is known early
+    lsp_timer_init(&probe_timer, link_probe_timer, NULL);
+    lsp_timer_arm(&probe_timer, 0);
+#endif
+    return LSP_ERR_NONE;
+}
+
+int lsp_link_input(lsp_buffer_t *buff)
+{
+    int rc = LSP_ERR_NONE;
+    lsp_interface_t *iface = buff->iface;
+    lsp_addr_t src = buff->lsp_packet->src_addr;
+    lsp_link_probe_t *probe;
+    uint32_t rtt;
+
+    lsp_buffer_pull(buff, sizeof(lsp_packet_t));
+    if (lsp_buffer_length(buff) < sizeof(lsp_link_probe_t))
+    {
+        lsp_verb(tag, "%s: malformed probe from %04X on %s\n", __FUNCTION__, src, iface->ifname);
+        LSP_IF_STATS_INC(iface, rx_error);
+        rc = LSP_ERR_INVALID;
+        goto end;
+    }
+
+    probe = (lsp_link_probe_t *)buff->data;
+    switch (probe->type)
+    {
+    case LINK_PROBE_REQUEST:
+        rc = link_send(iface, src, LINK_PROBE_REPLY, probe->timestamp);
+        break;
+    case LINK_PROBE_REPLY:
+        rtt = lsp_gettime_us() - probe->timestamp;
+        iface->link.rtt_us = link_ewma(iface->link.rtt_us, rtt > 0 ? rtt : 1);
+        break;
+    default:
+        rc = LSP_ERR_INVALID;
+        break;
+    }
+
+end:
+    lsp_buffer_free(buff);
+    return rc;
+}
+
+void lsp_link_getest(lsp_interface_t *iface, lsp_link_est_t *est)
+{
+    *est = iface->link;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp_lpm.h"
+#include "lsp_memory.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+static const char *tag = "lsp_lpm";
+
+static inline void lpm_set(lsp_lpm_entry_t *entry, void *data, uint8_t depth)
+{
+    if (entry->depth <= depth)
+    {
+        entry->data = data;
+        entry->depth = depth;
+    }
+}
+
+static inline void lpm_reset(lsp_lpm_entry_t *entry, void *data, uint8_t depth, void *parent, uint8_t parent_depth)
+{
+    if (entry->data == data && entry->depth == depth)
+    {
+        entry->data = parent;
+        entry->depth = parent_depth;
+    }
+}
+
+/** frees a group once all of its entries match the covering entry in hi again,
+ * lookups then fall back to hi */
+static void lpm_group_trim(lsp_lpm_t *lpm, int i)
+{
+    lsp_lpm_entry_t *group = lpm->groups[i];
+    lsp_lpm_entry_t *parent = &lpm->hi[i];
+
+    for (int j = 0; j < 256; ++j)
+    {
+        if (group[j].data != parent->data || group[j].depth != parent->depth)
+            return;
+    }
+    lpm->groups[i] = NULL;
+    lsp_free(group);
+}
+
+int lsp_lpm_insert(lsp_lpm_t *lpm, lsp_addr_t addr, uint8_t len, void *data)
+{
+    lsp_lpm_entry_t *group;
+    uint8_t depth = len + 1;
+    int first, count;
+
+    if (len > LSP_PACKET_ADDR_BITS || data == NULL)
+        return LSP_ERR_INVALID;
+    addr &= lsp_lpm_mask(len);
+
+    if (len <= 8)
+    {
+        first = addr >> 8;
+        count = 1 << (8 - len);
+        for (int i = first; i < first + count; ++i)
+        {
+            lpm_set(&lpm->hi[i], data, depth);
+            if (lpm->groups[i] != NULL)
+                for (int j = 0; j < 256; ++j)
+                    lpm_set(&lpm->groups[i][j], data, depth);
+        }
+        return LSP_ERR_NONE;
+    }
+
+    group = lpm->groups[addr >> 8];
+    if (group == NULL)
+    {
+        group = lsp_malloc(256 * sizeof(lsp_lpm_entry_t));
+        if (group == NULL)
+        {
+            lsp_verb(tag, "%s: could not allocate group for %04X/%u\n", __FUNCTION__, addr, len);
+            return LSP_ERR_NOMEM;
+        }
+        // group inherits the /8 or shorter prefix covering it
+        for (int j = 0; j < 256; ++j)
+            group[j] = lpm->hi[addr >> 8];
+        lpm->groups[addr >> 8] = group;
+    }
+
+    first = addr & 0xFF;
+    count = 1 << (16 - len);
+    for (int j = first; j < first + count; ++j)
+        lpm_set(&group[j], data, depth);
+    return LSP_ERR_NONE;
+}
+
+void lsp_lpm_delete(lsp_lpm_t *lpm, lsp_addr_t addr, uint8_t len, void *data, void *parent, uint8_t parent_len)
+{
+    lsp_lpm_entry_t *group;
+    uint8_t depth = len + 1;
+    uint8_t parent_depth = (parent != NULL ? parent_len + 1 : 0);
+    int first, count;
+
+    addr &= lsp_lpm_mask(len);
+    if (len <= 8)
+    {
+        first = addr >> 8;
+        count = 1 << (8 - len);
+        for (int i = first; i < first + count; ++i)
+        {
+            lpm_reset(&lpm->hi[i], data, depth, parent, parent_depth);
+            if (lpm->groups[i] != NULL)
+                for (int j = 0; j < 256; ++j)
+                    lpm_reset(&lpm->groups[i][j], data, depth, parent, parent_depth);
+        }
+        return;
+    }
+
+    group = lpm->groups[addr >> 8];
+    if (group == NULL)
+        return;
+
+    first = addr & 0xFF;
+    count = 1 << (16 - len);
+    for (int j = first; j < first + count; ++j)
+        lpm_reset(&group[j], data, depth, parent, parent_depth);
+    lpm_group_trim(lpm, addr >> 8);
+}
+
+void lsp_lpm_free(lsp_lpm_t *lpm)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        lsp_free(lpm->groups[i]);
+        lpm->groups[i] = NULL;
+    }
+    memset(lpm->hi, 0, sizeof(lpm->hi));
+}
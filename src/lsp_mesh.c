@@ -0,0 +1,232 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_mesh.h"
+#include "lsp_routing.h"
+#include "lsp_iflist.h"
+#include "lsp_buffer.h"
+#include "lsp_log.h"
+
+#include "string.h"
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+
+#ifndef LSP_MESH_MAX_ENTRIES
+#define LSP_MESH_MAX_ENTRIES 64
+#endif
+
+static const char *tag = "lsp_mesh";
+
+/** context for building advertisements on a single interface */
+struct mesh_ctx
+{
+    lsp_interface_t *iface;
+    lsp_buffer_t *buff;
+    lsp_mesh_hdr_t *hdr;
+    uint8_t type;
+    uint8_t max;
+};
+
+static uint32_t next_update;
+static uint32_t last_trigger;
+static lsp_mesh_stats_t mesh_stats;
+
+static inline uint8_t mesh_max_entries(lsp_interface_t *iface)
+{
+    size_t len = LSP_PACKET_PLEN_MAX;
+    if (iface->mtu > sizeof(lsp_packet_t) && iface->mtu - sizeof(lsp_packet_t) < len)
+        len = iface->mtu - sizeof(lsp_packet_t);
+
+    len = (len - sizeof(lsp_mesh_hdr_t)) / sizeof(lsp_mesh_entry_t);
+    return len < LSP_MESH_MAX_ENTRIES ? len : LSP_MESH_MAX_ENTRIES;
+}
+
+static int mesh_begin(struct mesh_ctx *ctx)
+{
+    lsp_packet_t *pkt;
+    size_t len = sizeof(lsp_packet_t) + sizeof(lsp_mesh_hdr_t) + ctx->max * sizeof(lsp_mesh_entry_t);
+
+    ctx->buff = lsp_buffer_alloc(ctx->iface, len);
+    if (ctx->buff == NULL)
+        return LSP_ERR_NOMEM;
+
+    pkt = lsp_buffer_put(ctx->buff, sizeof(lsp_packet_t));
+    memset(pkt, 0, sizeof(lsp_packet_t));
+    pkt->dst_addr = LSP_ADDR_ANY;
+    pkt->src_addr = lsp_conf->addr;
+    pkt->src_port = LSP_SP_SYS;
+    pkt->dst_port = LSP_SP_SYS;
+
+    ctx->hdr = lsp_buffer_put(ctx->buff, sizeof(lsp_mesh_hdr_t));
+    ctx->hdr->type = ctx->type;
+    ctx->hdr->count = 0;
+    return LSP_ERR_NONE;
+}
+
+static void mesh_flush(struct mesh_ctx *ctx)
+{
+    if (ctx->buff == NULL)
+        return;
+
+    ctx->buff->lsp_packet->plen = lsp_buffer_length(ctx->buff) - sizeof(lsp_packet_t);
+    lsp_interface_xmit(ctx->iface, ctx->buff);
+    ctx->buff = NULL;
+
+    if (ctx->type == MESH_UPDATE_FULL)
+        mesh_stats.updates_tx++;
+    else
+        mesh_stats.triggered_tx++;
+}
+
+static int mesh_append(struct mesh_ctx *ctx, lsp_addr_t addr, uint16_t cost)
+{
+    lsp_mesh_entry_t *entry;
+
+    if (ctx->buff == NULL && mesh_begin(ctx) != LSP_ERR_NONE)
+        return LSP_ERR_NOMEM;
+
+    entry = lsp_buffer_put(ctx->buff, sizeof(lsp_mesh_entry_t));
+    entry->addr = addr;
+    entry->cost = cost;
+
+    if (++ctx->hdr->count >= ctx->max)
+        mesh_flush(ctx);
+    return LSP_ERR_NONE;
+}
+
+static int mesh_collect(lsp_route_t *route, void *arg)
+{
+    struct mesh_ctx *ctx = arg;
+
+    if (ctx->type == MESH_UPDATE_TRIGGERED && !route->changed)
+        return 0;
+
+    // split horizon, never advertise a route back on the link it was learned from
+    for (int i = 0; i < route->npaths; ++i)
+        if (route->paths[i].iface == ctx->iface)
+            return 0;
+
+    return mesh_append(ctx, route->addr, route->hop.cost) != LSP_ERR_NONE;
+}
+
+static void mesh_send(uint8_t type)
+{
+    struct mesh_ctx ctx = {.type = type};
+
+    for (ctx.iface = lsp_iflist_next(NULL); ctx.iface != NULL; ctx.iface = lsp_iflist_next(ctx.iface))
+    {
+        ctx.buff = NULL;
+        ctx.max = mesh_max_entries(ctx.iface);
+
+        // full updates also announce ourselves so neighbors can discover the link
+        if (type == MESH_UPDATE_FULL && mesh_append(&ctx, lsp_conf->addr, 0) != LSP_ERR_NONE)
+            continue;
+
+        lsp_routing_foreach(mesh_collect, &ctx);
+        mesh_flush(&ctx);
+    }
+    lsp_routing_clear_changed();
+}
+
+uint32_t lsp_mesh_tick(uint32_t now)
+{
+    uint32_t next;
+
+    if (lsp_routing_changed())
+        mesh_stats.last_change = now;
+
+    if ((int32_t)(now - next_update) >= 0)
+    {
+        mesh_send(MESH_UPDATE_FULL);
+        next_update = now + LSP_DEFAULT_MESH_UPDATE_MS;
+        last_trigger = now;
+    }
+    else if (lsp_routing_changed() && now - last_trigger >= LSP_DEFAULT_MESH_TRIGGER_MS)
+    {
+        mesh_send(MESH_UPDATE_TRIGGERED);
+        last_trigger = now;
+    }
+
+    next = next_update - now;
+    // changes are held down until the trigger interval elapses
+    if (lsp_routing_changed() && LSP_DEFAULT_MESH_TRIGGER_MS - (now - last_trigger) < next)
+        next = LSP_DEFAULT_MESH_TRIGGER_MS - (now - last_trigger);
+    return next;
+}
+
+int lsp_mesh_input(lsp_buffer_t *buff)
+{
+    int rc = LSP_ERR_NONE;
+    lsp_interface_t *iface = buff->iface;
+    lsp_addr_t src = buff->lsp_packet->src_addr;
+    lsp_mesh_hdr_t *hdr;
+    lsp_mesh_entry_t *entry;
+    uint16_t linkcost;
+    uint32_t cost;
+
+    if (src == lsp_conf->addr)
+        goto end;
+
+    lsp_buffer_pull(buff, sizeof(lsp_packet_t));
+    if (lsp_buffer_length(buff) < sizeof(lsp_mesh_hdr_t))
+        goto malformed;
+
+    hdr = lsp_buffer_pull(buff, sizeof(lsp_mesh_hdr_t));
+    if (lsp_buffer_length(buff) < hdr->count * sizeof(lsp_mesh_entry_t))
+        goto malformed;
+
+    mesh_stats.updates_rx++;
+    mesh_stats.entries_rx += hdr->count;
+
+    // advertisement proves that the neighbor is reachable through this link
+    lsp_route_add(iface, src, -1);
+    linkcost = lsp_route_neighbor_cost(iface, src);
+    if (linkcost >= LSP_ROUTE_COST_INFINITY)
+        goto end;
+
+    entry = (lsp_mesh_entry_t *)buff->data;
+    for (int i = 0; i < hdr->count; ++i, ++entry)
+    {
+        if (entry->addr == lsp_conf->addr || entry->addr == src)
+            continue;
+
+        cost = entry->cost + linkcost;
+        if (cost > LSP_ROUTE_COST_INFINITY)
+            cost = LSP_ROUTE_COST_INFINITY;
+        lsp_route_learn(iface, entry->addr, src, cost);
+    }
+    goto end;
+
+malformed:
+    lsp_verb(tag, "%s: malformed advertisement from %04X on %s\n", __FUNCTION__, src, iface->ifname);
+    mesh_stats.rx_error++;
+    rc = LSP_ERR_INVALID;
+end:
+    lsp_buffer_free(buff);
+    return rc;
+}
+
+void lsp_mesh_getstats(lsp_mesh_stats_t *stats)
+{
+    *stats = mesh_stats;
+}
+
+#endif
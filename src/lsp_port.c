@@ -21,6 +21,8 @@
 #include "lsp_port.h"
 #include "lsp_memory.h"
 #include "lsp_conn.h"
+#include "lsp_buffer.h"
+#include "lsp_interface.h"
 #include "lsp_log.h"
 
 #include "string.h"
@@ -72,6 +74,42 @@ lsp_port_t *lsp_port_get(uint8_t port)
     return &ports[port];
 }
 
+int lsp_port_input(lsp_buffer_t *buff, uint32_t timeout)
+{
+    int rc;
+    lsp_conn_t *conn;
+    lsp_packet_t *pkt = buff->lsp_packet;
+    lsp_port_t *port = &ports[pkt->dst_port];
+
+    if (port->state != PORT_OPEN)
+    {
+        lsp_verb(tag, "%s: port %u is closed, dropping packet\n", __FUNCTION__, pkt->dst_port);
+        rc = LSP_ERR_PORT_INVALID;
+        goto drop;
+    }
+
+    // sockets are sorted by priority, deliver to first matching socket
+    lsp_list_for(conn, portlist, &port->sockets)
+    {
+        if (conn->attr.raddr != LSP_ADDR_ANY && conn->attr.raddr != pkt->src_addr)
+            continue;
+
+        rc = lsp_conn_rxq_push(conn, buff, timeout);
+        if (rc != LSP_ERR_NONE)
+        {
+            LSP_IF_STATS_INC(buff->iface, dropped);
+            goto drop;
+        }
+        lsp_egroup_set(conn->egroup, CONN_EV_RECEIVE);
+        return LSP_ERR_NONE;
+    }
+    rc = LSP_ERR_ADDR_NOTFOUND;
+
+drop:
+    lsp_buffer_free(buff);
+    return rc;
+}
+
 int lsp_listen(lsp_socket_t sock, int backlog)
 {
     lsp_socket_t sk;
@@ -80,11 +118,11 @@ int lsp_listen(lsp_socket_t sock, int backlog)
     if (port > LSP_PACKET_PORT_MAX)
     {
         lsp_err(tag, "%s: invalid port, call lsp_bind first or possible corruption\n", __FUNCTION__);
-        return LSP_ERR_INVALID;
+        return -LSP_ERR_INVALID;
     }
 
     if (sock == NULL)
-        return LSP_ERR_INVALID;
+        return -LSP_ERR_INVALID;
 
     sock->type = CONN_SERVER;
     sock->type = CONN_LISTEN;
@@ -94,7 +132,7 @@ int lsp_listen(lsp_socket_t sock, int backlog)
     if (sock->children == NULL)
     {
         lsp_err(tag, "%s: could not create alloc mem for backlog\n", __FUNCTION__);
-        return LSP_ERR_NOMEM;
+        return -LSP_ERR_NOMEM;
     }
 
     if (lsp_list_is_empty(&ports[port].sockets))
@@ -124,8 +162,9 @@ int lsp_listen(lsp_socket_t sock, int backlog)
 int lsp_bind(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen)
 {
     int rc;
+    (void)addrlen; // unused
     if (sock == NULL)
-        return LSP_ERR_INVALID;
+        return -LSP_ERR_INVALID;
 
     if (sockaddr->port == LSP_PORT_ANY)
         sock->attr.lport = LSP_PACKET_PORT_MAX + 1;
@@ -133,13 +172,13 @@ int lsp_bind(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen)
     {
         lsp_err(tag, "%s: lsp_bind invalid port %u, portrange: 0-%u + (LSP_PORT_ANY for default)\n", __FUNCTION__,
                 sockaddr->port, LSP_PACKET_PORT_MAX);
-        return LSP_ERR_PORT_INVALID;
+        return -LSP_ERR_PORT_INVALID;
     }
 
     if (ports[sock->attr.lport].state != PORT_CLOSED)
     {
         lsp_verb(tag, "%s: lsp_bind port %u is already in use\n", __FUNCTION__, sock->attr.lport);
-        return LSP_ERR_PORT_IN_USE;
+        return -LSP_ERR_PORT_IN_USE;
     }
 
     lsp_info(tag, "%s: binding socket %p to port %u\n", __FUNCTION__, sock, sock->attr.lport);
@@ -23,67 +23,614 @@
 #include "lsp_log.h"
 #include "lsp_list.h"
 #include "lsp_time.h"
+#include "lsp_lpm.h"
 
 #include "string.h"
 
 static const char *tag = "lsp_routing";
 
+/** routing table, ordered by expiry (refreshed routes are moved to the back) */
 static lsp_list_head_t rtable = LSP_LIST_HEAD_INIT(rtable);
 
+/** static prefix routes, never aged */
+static lsp_list_head_t rprefix = LSP_LIST_HEAD_INIT(rprefix);
+
+/** longest prefix match table over rtable and rprefix, used for all lookups */
+static lsp_lpm_t rlpm;
+
 /** TODO: replace this with an MSRW lock */
 static lsp_mutex_t rtable_mutex;
 
+/** Route aging callback */
+static lsp_route_cb_t rtable_cb;
+
+/** Routing stats */
+static lsp_routing_stats_t rtable_stats;
+
+/** rtable generation, bumped whenever lookups could resolve differently */
+static volatile uint32_t rtable_gen;
+
+#define ROUTE_IS_DUE(route, now) ((int32_t)((now) - (route)->expiry) >= 0)
+
 int lsp_routing_init()
 {
     // for now mutex only needs initialization
     return lsp_mutex_init(&rtable_mutex);
 }
 
+int lsp_routing_free()
+{
+    lsp_route_t *route;
+    lsp_list_head_t *lists[] = {&rtable, &rprefix};
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    for (int i = 0; i < 2; ++i)
+    {
+        while (!lsp_list_is_empty(lists[i]))
+        {
+            route = container_of(lists[i]->next, lsp_route_t, rlist);
+            lsp_list_del(&route->rlist);
+            lsp_free(route);
+        }
+    }
+    lsp_lpm_free(&rlpm);
+    rtable_gen++;
+    lsp_mutex_unlock(&rtable_mutex);
+
+    return lsp_mutex_destroy(&rtable_mutex);
+}
+
+static inline void route_touch(lsp_route_t *route, uint32_t now)
+{
+    route->expiry = now + LSP_DEFAULT_ROUTE_EXPIRY_MS;
+    // all routes share the same expiry interval so moving to back keeps rtable sorted
+    lsp_list_move_tail(&route->rlist, &rtable);
+}
+
+/** internal use only! rtable_mutex must be held, returns the host route to addr */
+static inline lsp_route_t *route_lookup(lsp_addr_t addr)
+{
+    lsp_route_t *route = lsp_lpm_lookup(&rlpm, addr);
+    if (route != NULL && route->prefixlen == LSP_PACKET_ADDR_BITS)
+        return route;
+    return NULL;
+}
+
+/** internal use only! rtable_mutex must be held, returns the longest prefix route shorter than len covering addr */
+static lsp_route_t *route_prefix_parent(lsp_addr_t addr, uint8_t len)
+{
+    lsp_route_t *route, *parent = NULL;
+    lsp_list_for(route, rlist, &rprefix)
+    {
+        if (route->prefixlen < len &&
+            (addr & lsp_lpm_mask(route->prefixlen)) == route->addr &&
+            (parent == NULL || route->prefixlen > parent->prefixlen))
+            parent = route;
+    }
+    return parent;
+}
+
+/** internal use only! rtable_mutex must be held, removes route from lpm table */
+static void route_lpm_delete(lsp_route_t *route)
+{
+    lsp_route_t *parent = route_prefix_parent(route->addr, route->prefixlen);
+    lsp_lpm_delete(&rlpm, route->addr, route->prefixlen, route,
+                   parent, parent != NULL ? parent->prefixlen : 0);
+}
+
+/** internal use only! rtable_mutex must be held */
+static lsp_route_t *route_new(lsp_interface_t *iface, lsp_addr_t addr, uint32_t now)
+{
+    lsp_route_t *route = lsp_malloc(sizeof(lsp_route_t));
+    if (route == NULL)
+        return NULL;
+
+    memset(route, 0, sizeof(lsp_route_t));
+    route->iface = iface;
+    route->addr = addr;
+    route->prefixlen = LSP_PACKET_ADDR_BITS;
+    route->state = ROUTE_ACTIVE;
+    route->timestamp = now;
+    route->expiry = now + LSP_DEFAULT_ROUTE_EXPIRY_MS;
+    if (lsp_lpm_insert(&rlpm, addr, route->prefixlen, route) != LSP_ERR_NONE)
+    {
+        lsp_free(route);
+        return NULL;
+    }
+    lsp_list_add_tail(&route->rlist, &rtable);
+    rtable_stats.added++;
+    rtable_gen++;
+    return route;
+}
+
+static inline uint16_t route_cost(lsp_route_t *route)
+{
+#if (LSP_ROUTING_HOPS_ENABLED)
+    return route->hop.cost;
+#else
+    return lsp_route_linkcost(route->linkspeed);
+#endif
+}
+
+static inline int route_is_direct(lsp_route_t *route)
+{
+#if (LSP_ROUTING_HOPS_ENABLED)
+    return route->hop.next_hop == route->addr;
+#else
+    return 1;
+#endif
+}
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+/** number of routes with pending advertisement */
+static int rtable_changed;
+
+static inline void route_set_hop(lsp_route_t *route, lsp_addr_t next_hop, uint16_t cost)
+{
+    if (route->hop.next_hop == next_hop && route->hop.cost == cost)
+        return;
+    route->hop.next_hop = next_hop;
+    route->hop.cost = cost;
+    if (!route->changed)
+    {
+        route->changed = 1;
+        rtable_changed++;
+    }
+}
+#endif
+
+uint16_t lsp_route_linkcost(uint32_t linkspeed)
+{
+    uint32_t cost;
+    if (linkspeed == 0 || linkspeed == (uint32_t)-1)
+        return LSP_DEFAULT_MESH_COST_UNKNOWN;
+
+    cost = LSP_DEFAULT_MESH_COST_REF / linkspeed;
+    if (cost < 1)
+        cost = 1;
+    else if (cost >= LSP_ROUTE_COST_INFINITY)
+        cost = LSP_ROUTE_COST_INFINITY - 1;
+    return cost;
+}
+
+/** internal use only! rtable_mutex must be held */
+static inline lsp_route_path_t *route_path_find(lsp_route_t *route, lsp_interface_t *iface)
+{
+    for (int i = 0; i < route->npaths; ++i)
+        if (route->paths[i].iface == iface)
+            return &route->paths[i];
+    return NULL;
+}
+
+/** internal use only! drops paths not rediscovered within expiry time and recalculates weights.
+ * The last path is kept so route->iface always matches a path, the route itself expires through aging */
+static void route_update_paths(lsp_route_t *route, uint32_t now)
+{
+    lsp_route_path_t *best = NULL;
+    lsp_interface_t *iface = route->iface;
+    uint8_t npaths = route->npaths;
+    uint32_t weight_total = route->weight_total;
+
+    for (int i = 0; i < route->npaths;)
+    {
+        if (route->npaths > 1 && (int32_t)(now - route->paths[i].timestamp) >= LSP_DEFAULT_ROUTE_EXPIRY_MS)
+        {
+            lsp_verb(tag, "%s: path for %04X via %s expired\n",
+                     __FUNCTION__, route->addr, route->paths[i].iface->ifname);
+            route->paths[i] = route->paths[--route->npaths];
+            continue;
+        }
+        ++i;
+    }
+
+    route->weight_total = 0;
+    for (int i = 0; i < route->npaths; ++i)
+    {
+        lsp_route_path_t *path = &route->paths[i];
+        // linkcost is inversely proportional to linkspeed
+        path->weight = 65536 / lsp_route_linkcost(path->linkspeed);
+        route->weight_total += path->weight;
+        if (best == NULL || path->weight > best->weight)
+            best = path;
+    }
+
+    if (best != NULL)
+    {
+        route->iface = best->iface;
+        route->linkspeed = best->linkspeed;
+    }
+
+    if (route->iface != iface || route->npaths != npaths || route->weight_total != weight_total)
+        rtable_gen++;
+}
+
+/** internal use only! replaces all paths of route */
+static void route_set_path(lsp_route_t *route, lsp_interface_t *iface, int linkspeed, uint32_t now)
+{
+    if (route->npaths > 1)
+        rtable_gen++;
+    memset(route->paths, 0, sizeof(route->paths));
+    route->npaths = 1;
+    route->paths[0].iface = iface;
+    route->paths[0].linkspeed = linkspeed;
+    route->paths[0].timestamp = now;
+    route_update_paths(route, now);
+}
+
 int lsp_route_add(lsp_interface_t *iface, lsp_addr_t addr, int linkspeed)
 {
-    size_t blocksize = sizeof(lsp_route_t);
+    uint32_t now = lsp_gettime_ms();
     lsp_route_t *route = NULL;
+    lsp_route_path_t *path;
+
+    // a measured linkspeed is better than no guess
+    if (linkspeed == -1 && iface->link.reported != 0)
+        linkspeed = iface->link.reported;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
 
     // check if route already exist for this addr
+    route = route_lookup(addr);
+    if (route == NULL)
+    {
+        route = route_new(iface, addr, now);
+        if (route == NULL)
+        {
+            lsp_mutex_unlock(&rtable_mutex);
+            return LSP_ERR_NOMEM;
+        }
+
+        route_set_path(route, iface, linkspeed, now);
+
+        lsp_verb(tag, "%s: route for %04X added via %s\n",
+                 __FUNCTION__, addr, iface->ifname);
+    }
+    else if (route->state == ROUTE_ACTIVE && route_is_direct(route))
+    {
+        // link to directly connected node discovered, keep all links as paths
+        path = route_path_find(route, iface);
+        if (path == NULL)
+            route_update_paths(route, now); // make room from expired paths
+
+        if (path == NULL && route->npaths < LSP_DEFAULT_ROUTE_MAX_PATHS)
+        {
+            path = &route->paths[route->npaths++];
+            memset(path, 0, sizeof(lsp_route_path_t));
+            path->iface = iface;
+            path->linkspeed = linkspeed;
+
+            lsp_verb(tag, "%s: path for %04X added via %s\n",
+                     __FUNCTION__, addr, iface->ifname);
+        }
+
+        if (path != NULL)
+        {
+            if (linkspeed != -1)
+                path->linkspeed = linkspeed;
+            path->timestamp = now;
+        }
+
+        route_update_paths(route, now);
+        route->timestamp = now;
+        route_touch(route, now);
+        rtable_stats.refreshed++;
+    }
+    else if (route->state == ROUTE_STALE || lsp_route_linkcost(linkspeed) < route_cost(route))
+    {
+        // replace route if linkspeed is better or current route went stale
+        lsp_verb(tag, "%s: route for %04X replaced via %s\n",
+                 __FUNCTION__, addr, iface->ifname);
+
+        // rediscovered before it expired
+        if (route->state == ROUTE_STALE)
+            rtable_stats.refreshed++;
+        route_set_path(route, iface, linkspeed, now);
+        route->state = ROUTE_ACTIVE;
+        route->timestamp = now;
+        route_touch(route, now);
+    }
+    else
+        goto end;
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+    route_set_hop(route, addr, lsp_route_linkcost(route->linkspeed));
+#endif
+
+end:
+    lsp_mutex_unlock(&rtable_mutex);
+    return LSP_ERR_NONE;
+}
+
+void lsp_route_set_linkspeed(lsp_interface_t *iface, uint32_t linkspeed)
+{
+    uint32_t now = lsp_gettime_ms();
+    lsp_route_t *route;
+    lsp_route_path_t *path;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
     lsp_list_for(route, rlist, &rtable)
     {
-        if (route->addr == addr)
-            break;
+        // learned routes take their cost from advertisements
+        if (!route_is_direct(route) || (path = route_path_find(route, iface)) == NULL)
+            continue;
+
+        path->linkspeed = linkspeed;
+        route_update_paths(route, now);
+#if (LSP_ROUTING_HOPS_ENABLED)
+        route_set_hop(route, route->addr, lsp_route_linkcost(route->linkspeed));
+#endif
+    }
+
+    lsp_list_for(route, rlist, &rprefix)
+    {
+        // prefix routes are never refreshed, update in place instead of expiring the path
+        if (route->iface != iface)
+            continue;
+
+        route->paths[0].linkspeed = route->linkspeed = linkspeed;
+#if (LSP_ROUTING_HOPS_ENABLED)
+        route->hop.cost = lsp_route_linkcost(linkspeed);
+#endif
+        rtable_gen++;
     }
+    lsp_mutex_unlock(&rtable_mutex);
+}
 
+void lsp_route_flush_iface(lsp_interface_t *iface)
+{
+    LSP_LIST_HEAD(dead);
+    uint32_t now = lsp_gettime_ms();
+    lsp_list_t *node, *next;
+    lsp_route_t *route;
+    lsp_route_path_t *path;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    for (node = rtable.next; node != &rtable; node = next)
+    {
+        next = node->next;
+        route = container_of(node, lsp_route_t, rlist);
+        path = route_path_find(route, iface);
+        if (path == NULL && route->iface != iface)
+            continue;
+
+        // keep routes to directly connected nodes through their remaining links,
+        // preferred interface moves to one of them
+        if (path != NULL)
+            *path = route->paths[--route->npaths];
+        if (route->npaths > 0)
+        {
+            route_update_paths(route, now);
+#if (LSP_ROUTING_HOPS_ENABLED)
+            route_set_hop(route, route->addr, lsp_route_linkcost(route->linkspeed));
+#endif
+            rtable_gen++;
+            continue;
+        }
+
+        lsp_list_del(&route->rlist);
+        route_lpm_delete(route);
+#if (LSP_ROUTING_HOPS_ENABLED)
+        if (route->changed)
+            rtable_changed--;
+#endif
+        rtable_stats.expired++;
+        lsp_list_add_tail(&route->rlist, &dead);
+    }
+
+    for (node = rprefix.next; node != &rprefix; node = next)
+    {
+        next = node->next;
+        route = container_of(node, lsp_route_t, rlist);
+        if (route->iface != iface)
+            continue;
+
+        lsp_list_del(&route->rlist);
+        route_lpm_delete(route);
+        lsp_list_add_tail(&route->rlist, &dead);
+    }
+    rtable_gen++;
+    lsp_mutex_unlock(&rtable_mutex);
+
+    while (!lsp_list_is_empty(&dead))
+    {
+        route = container_of(dead.next, lsp_route_t, rlist);
+        lsp_list_del(&route->rlist);
+        lsp_verb(tag, "%s: route for %04X/%u via %s removed\n",
+                 __FUNCTION__, route->addr, route->prefixlen, iface->ifname);
+        if (rtable_cb != NULL && route->prefixlen == LSP_PACKET_ADDR_BITS)
+            rtable_cb(route, ROUTE_EV_EXPIRED);
+        lsp_free(route);
+    }
+}
+
+#if (LSP_ROUTING_HOPS_ENABLED)
+int lsp_route_learn(lsp_interface_t *iface, lsp_addr_t addr, lsp_addr_t next_hop, uint16_t cost)
+{
+    uint32_t now = lsp_gettime_ms();
+    lsp_route_t *route;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+
+    route = route_lookup(addr);
     if (route == NULL)
     {
-        route = lsp_malloc(blocksize);
+        if (cost >= LSP_ROUTE_COST_INFINITY)
+            goto end;
+
+        route = route_new(iface, addr, now);
         if (route == NULL)
+        {
+            lsp_mutex_unlock(&rtable_mutex);
             return LSP_ERR_NOMEM;
+        }
+        route_set_path(route, iface, -1, now);
+        route_set_hop(route, next_hop, cost);
 
-        route->iface = iface;
-        route->addr = addr;
-        route->linkspeed;
-        route->timestamp = lsp_gettime_ms();
+        lsp_verb(tag, "%s: route for %04X learned via %04X on %s cost %u\n",
+                 __FUNCTION__, addr, next_hop, iface->ifname, cost);
+    }
+    else if (route->iface == iface && route->hop.next_hop == next_hop)
+    {
+        // always follow our current next hop, even if it got worse
+        route_set_hop(route, next_hop, cost);
+        if (cost >= LSP_ROUTE_COST_INFINITY)
+        {
+            // unreachable, let aging remove the route
+            route->state = ROUTE_STALE;
+            goto end;
+        }
+        route->state = ROUTE_ACTIVE;
+        route->timestamp = now;
+        route->paths[0].timestamp = now;
+        route_touch(route, now);
+        rtable_stats.refreshed++;
+    }
+    else if (cost < LSP_ROUTE_COST_INFINITY &&
+             (route->state == ROUTE_STALE || cost < route->hop.cost))
+    {
+        lsp_verb(tag, "%s: route for %04X replaced via %04X on %s cost %u\n",
+                 __FUNCTION__, addr, next_hop, iface->ifname, cost);
 
-        lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
-        lsp_list_add(&route->rlist, &rtable);
-        lsp_mutex_unlock(&rtable_mutex);
+        route_set_path(route, iface, -1, now);
+        route->state = ROUTE_ACTIVE;
+        route->timestamp = now;
+        route_set_hop(route, next_hop, cost);
+        route_touch(route, now);
+    }
 
-        lsp_verb(tag, "%s: route for %04X added via %s\n",
-                 __FUNCTION__, addr, iface->ifname);
+end:
+    lsp_mutex_unlock(&rtable_mutex);
+    return LSP_ERR_NONE;
+}
+
+uint16_t lsp_route_neighbor_cost(lsp_interface_t *iface, lsp_addr_t addr)
+{
+    uint16_t cost = LSP_ROUTE_COST_INFINITY;
+    lsp_route_t *route;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    route = route_lookup(addr);
+    if (route != NULL && route->iface == iface && route_is_direct(route))
+        cost = route->hop.cost;
+    lsp_mutex_unlock(&rtable_mutex);
+
+    return cost;
+}
+
+void lsp_routing_foreach(int (*fn)(lsp_route_t *route, void *arg), void *arg)
+{
+    lsp_route_t *route;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    lsp_list_for(route, rlist, &rtable)
+    {
+        if (fn(route, arg))
+            break;
     }
-    else
+    lsp_mutex_unlock(&rtable_mutex);
+}
+
+int lsp_routing_changed()
+{
+    return rtable_changed;
+}
+
+static int route_clear_changed(lsp_route_t *route, void *arg)
+{
+    (void)arg; // unused
+    route->changed = 0;
+    return 0;
+}
+
+void lsp_routing_clear_changed()
+{
+    lsp_routing_foreach(route_clear_changed, NULL);
+    rtable_changed = 0;
+}
+#endif
+
+int lsp_route_add_prefix(lsp_interface_t *iface, lsp_addr_t addr, uint8_t prefixlen, int linkspeed)
+{
+    int rc = LSP_ERR_NONE;
+    uint32_t now = lsp_gettime_ms();
+    lsp_route_t *route;
+
+    if (prefixlen > LSP_PACKET_ADDR_BITS)
+        return LSP_ERR_INVALID;
+    addr &= lsp_lpm_mask(prefixlen);
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+
+    lsp_list_for(route, rlist, &rprefix)
     {
-        // replace route if linkspeed is better
-        if (linkspeed < route->linkspeed)
+        if (route->addr == addr && route->prefixlen == prefixlen)
+            break;
+    }
+
+    if (route == NULL)
+    {
+        route = lsp_malloc(sizeof(lsp_route_t));
+        if (route == NULL)
         {
-            lsp_verb(tag, "%s: route for %04X replaced via %s\n",
-                     __FUNCTION__, addr, iface->ifname);
+            rc = LSP_ERR_NOMEM;
+            goto end;
+        }
+        memset(route, 0, sizeof(lsp_route_t));
+        route->addr = addr;
+        route->prefixlen = prefixlen;
+        route->state = ROUTE_ACTIVE;
 
-            lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
-            route->iface = iface;
-            route->linkspeed = linkspeed;
-            route->timestamp = lsp_gettime_ms();
-            lsp_mutex_unlock(&rtable_mutex);
+        rc = lsp_lpm_insert(&rlpm, addr, prefixlen, route);
+        if (rc != LSP_ERR_NONE)
+        {
+            lsp_free(route);
+            goto end;
         }
+        lsp_list_add_tail(&route->rlist, &rprefix);
+        rtable_stats.added++;
+    }
+
+    lsp_verb(tag, "%s: route for %04X/%u via %s\n",
+             __FUNCTION__, addr, prefixlen, iface->ifname);
+
+    route->timestamp = now;
+    route_set_path(route, iface, linkspeed, now);
+#if (LSP_ROUTING_HOPS_ENABLED)
+    route->hop.next_hop = addr;
+    route->hop.cost = lsp_route_linkcost(route->linkspeed);
+#endif
+    rtable_gen++;
+
+end:
+    lsp_mutex_unlock(&rtable_mutex);
+    return rc;
+}
+
+int lsp_route_del_prefix(lsp_addr_t addr, uint8_t prefixlen)
+{
+    lsp_route_t *route;
+
+    addr &= lsp_lpm_mask(prefixlen);
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    lsp_list_for(route, rlist, &rprefix)
+    {
+        if (route->addr == addr && route->prefixlen == prefixlen)
+            break;
+    }
+
+    if (route == NULL)
+    {
+        lsp_mutex_unlock(&rtable_mutex);
+        return LSP_ERR_ADDR_NOTFOUND;
     }
+
+    lsp_list_del(&route->rlist);
+    route_lpm_delete(route);
+    rtable_gen++;
+    lsp_mutex_unlock(&rtable_mutex);
+
+    lsp_free(route);
     return LSP_ERR_NONE;
 }
 
@@ -92,11 +639,161 @@ lsp_interface_t *lsp_route_find(lsp_addr_t addr)
     lsp_interface_t *iface = NULL;
     lsp_route_t *route;
 
-    lsp_list_for(route, rlist, &rtable)
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    route = lsp_lpm_lookup(&rlpm, addr);
+    if (route != NULL)
+        iface = route->iface;
+    lsp_mutex_unlock(&rtable_mutex);
+
+    return iface;
+}
+
+lsp_interface_t *lsp_route_select(lsp_addr_t addr, uint32_t flowhash, size_t len)
+{
+    lsp_interface_t *iface = NULL;
+    lsp_route_path_t *path;
+    lsp_route_t *route;
+    uint32_t h;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    route = lsp_lpm_lookup(&rlpm, addr);
+    if (route == NULL)
+        goto end;
+
+    path = &route->paths[0];
+    if (route->npaths > 1)
     {
-        if (route->addr == addr)
-            return route->iface;
+        // weighted pick, same hash always maps to the same path
+        h = flowhash % route->weight_total;
+        while (h >= path->weight)
+        {
+            h -= path->weight;
+            path++;
+        }
     }
 
+    if (len > 0)
+    {
+        path->tx_count++;
+        path->tx_bytes += len;
+    }
+    iface = path->iface;
+end:
+    lsp_mutex_unlock(&rtable_mutex);
     return iface;
-}
\ No newline at end of file
+}
+
+void lsp_route_account(lsp_addr_t addr, lsp_interface_t *iface, uint32_t count, uint64_t bytes)
+{
+    lsp_route_t *route;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    route = lsp_lpm_lookup(&rlpm, addr);
+    if (route == NULL)
+        goto end;
+
+    // path may be gone if rtable changed since the caller resolved it
+    for (int i = 0; i < route->npaths; ++i)
+    {
+        if (route->paths[i].iface == iface)
+        {
+            route->paths[i].tx_count += count;
+            route->paths[i].tx_bytes += bytes;
+            break;
+        }
+    }
+end:
+    lsp_mutex_unlock(&rtable_mutex);
+}
+
+int lsp_route_getpaths(lsp_addr_t addr, lsp_route_path_t *paths, int max)
+{
+    int count = 0;
+    lsp_route_t *route;
+
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    route = route_lookup(addr);
+    if (route != NULL)
+    {
+        count = route->npaths < max ? route->npaths : max;
+        memcpy(paths, route->paths, count * sizeof(lsp_route_path_t));
+    }
+    lsp_mutex_unlock(&rtable_mutex);
+
+    return count;
+}
+
+uint32_t lsp_routing_age(uint32_t now)
+{
+    lsp_route_t *route, demoted;
+    lsp_route_event_t ev;
+    uint32_t next = LSP_TIMEOUT_MAX;
+
+    for (;;)
+    {
+        lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+        if (lsp_list_is_empty(&rtable))
+            break;
+
+        // rtable is sorted by expiry, stop on first route not yet due
+        route = container_of(rtable.next, lsp_route_t, rlist);
+        if (!ROUTE_IS_DUE(route, now))
+        {
+            next = route->expiry - now;
+            break;
+        }
+
+        if (route->state == ROUTE_ACTIVE)
+        {
+            lsp_verb(tag, "%s: route for %04X via %s is stale\n",
+                     __FUNCTION__, route->addr, route->iface->ifname);
+            route->state = ROUTE_STALE;
+            route_touch(route, now);
+            rtable_stats.demoted++;
+            ev = ROUTE_EV_DEMOTED;
+            // route stays in rtable and may be freed by a flush once unlocked
+            demoted = *route;
+            route = &demoted;
+        }
+        else
+        {
+            lsp_verb(tag, "%s: route for %04X via %s expired\n",
+                     __FUNCTION__, route->addr, route->iface->ifname);
+            lsp_list_del(&route->rlist);
+            route_lpm_delete(route);
+#if (LSP_ROUTING_HOPS_ENABLED)
+            if (route->changed)
+                rtable_changed--;
+#endif
+            rtable_stats.expired++;
+            rtable_gen++;
+            ev = ROUTE_EV_EXPIRED;
+        }
+        lsp_mutex_unlock(&rtable_mutex);
+
+        if (rtable_cb != NULL)
+            rtable_cb(route, ev);
+        if (ev == ROUTE_EV_EXPIRED)
+            lsp_free(route);
+    }
+    lsp_mutex_unlock(&rtable_mutex);
+
+    return next;
+}
+
+uint32_t lsp_routing_generation()
+{
+    return rtable_gen;
+}
+
+void lsp_routing_set_cb(lsp_route_cb_t cb)
+{
+    rtable_cb = cb;
+}
+
+void lsp_routing_getstats(lsp_routing_stats_t *stats)
+{
+    lsp_mutex_lock(&rtable_mutex, LSP_TIMEOUT_MAX);
+    *stats = rtable_stats;
+    lsp_mutex_unlock(&rtable_mutex);
+}
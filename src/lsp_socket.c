@@ -18,9 +18,13 @@
  */
 
 #include "lsp.h"
+#include "lsp_socket.h"
 #include "lsp_port.h"
 #include "lsp_memory.h"
 #include "lsp_conn.h"
+#include "lsp_buffer.h"
+#include "lsp_iflist.h"
+#include "lsp_queue.h"
 #include "lsp_log.h"
 
 #include "string.h"
@@ -101,6 +105,8 @@ lsp_socket_t lsp_accept(lsp_socket_t sock, uint32_t timeout)
 
 int lsp_connect(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen)
 {
+    (void)addrlen; // unused
+
     if (sockaddr->port == LSP_PORT_ANY)
     {
         sock->attr.rport = LSP_PACKET_PORT_MAX + 1;
@@ -109,11 +115,151 @@ int lsp_connect(lsp_socket_t sock, lsp_sockaddr_t *sockaddr, size_t addrlen)
     {
         lsp_err(tag, "%s: invalid port %u, portrange: 0-%u + (LSP_PORT_ANY for default)\n", __FUNCTION__,
                 sockaddr->port, LSP_PACKET_PORT_MAX);
-        return LSP_ERR_PORT_INVALID;
+        return -LSP_ERR_PORT_INVALID;
     }
+    else
+        sock->attr.rport = sockaddr->port;
 
     sock->attr.raddr = sockaddr->addr;
-    // TODO: add checks of remote address from routing table
+    if (lsp_conn_route(sock) != LSP_ERR_NONE)
+    {
+        lsp_err(tag, "%s: no route to %04X\n", __FUNCTION__, sockaddr->addr);
+        return -LSP_ERR_ADDR_NOTFOUND;
+    }
 
+    sock->state = CONN_CONNECTED;
     return LSP_ERR_NONE;
-}
\ No newline at end of file
+}
+
+int lsp_send(lsp_socket_t sock, const void *buf, size_t buflen, uint32_t flags)
+{
+    int rc;
+    lsp_interface_t *iface;
+    lsp_buffer_t *buff;
+    lsp_packet_t *pkt;
+    (void)flags; // unused
+
+    if (sock->state != CONN_CONNECTED)
+        return -LSP_ERR_SOCK_NOT_CONNECTED;
+
+    if (buflen > LSP_PACKET_PLEN_MAX)
+        return -LSP_ERR_INVALID;
+
+    // iface stays valid until the packet is queued, even if it is unregistered meanwhile
+    lsp_iflist_read_lock();
+
+    // steady state uses the route cached on connect
+    iface = lsp_conn_iface(sock);
+    if (iface == NULL)
+    {
+        rc = LSP_ERR_ADDR_NOTFOUND;
+        goto end;
+    }
+
+    buff = lsp_buffer_alloc(iface, sizeof(lsp_packet_t) + buflen);
+    if (buff == NULL)
+    {
+        rc = LSP_ERR_NOMEM;
+        goto end;
+    }
+
+    buff->priority = sock->attr.priority;
+    pkt = lsp_buffer_put(buff, sizeof(lsp_packet_t));
+    memset(pkt, 0, sizeof(lsp_packet_t));
+    pkt->dst_addr = sock->attr.raddr;
+    pkt->src_addr = lsp_conf->addr;
+    pkt->src_port = sock->attr.lport;
+    pkt->dst_port = sock->attr.rport;
+    pkt->plen = buflen;
+    memcpy(lsp_buffer_put(buff, buflen), buf, buflen);
+
+    rc = lsp_interface_xmit(iface, buff);
+    if (rc == LSP_ERR_NONE)
+        lsp_conn_account(sock, sizeof(lsp_packet_t) + buflen);
+
+end:
+    lsp_iflist_read_unlock();
+    if (rc != LSP_ERR_NONE)
+        return -rc;
+    return buflen;
+}
+
+int lsp_recvfrom(lsp_socket_t sock, void *buf, size_t buflen, uint32_t flags, lsp_sockaddr_t *sockaddr, size_t addrlen)
+{
+    int rc;
+    size_t len;
+    lsp_buffer_t *buff;
+    lsp_packet_t *pkt;
+    (void)flags;   // unused
+    (void)addrlen; // unused
+
+    if (sock == NULL || buf == NULL)
+        return -LSP_ERR_INVALID;
+
+    // busy polls up to LSP_SO_BUSY_POLL before sleeping on the rx_queue
+    rc = lsp_queue_pop(sock->rx_queue, &buff, sock->rcv_timeout);
+    if (rc != LSP_ERR_NONE)
+        return -rc;
+
+    pkt = buff->lsp_packet;
+    len = lsp_buffer_length(buff) - sizeof(lsp_packet_t);
+    if (pkt->plen < len)
+        len = pkt->plen;
+    // excess payload is discarded like a datagram
+    if (buflen < len)
+        len = buflen;
+    memcpy(buf, pkt + 1, len);
+
+    if (sockaddr != NULL)
+    {
+        sockaddr->addr = pkt->src_addr;
+        sockaddr->port = pkt->src_port;
+    }
+    lsp_buffer_free(buff);
+    return len;
+}
+
+int lsp_recv(lsp_socket_t sock, void *buf, size_t buflen, uint32_t flags)
+{
+    return lsp_recvfrom(sock, buf, buflen, flags, NULL, 0);
+}
+
+int lsp_setsockopt(lsp_socket_t sock, int level, int opt, const void *optval, size_t optlen)
+{
+    (void)level; // unused
+    if (sock == NULL || optval == NULL)
+        return -LSP_ERR_INVALID;
+
+    switch (opt)
+    {
+    case LSP_SO_BUSY_POLL:
+        if (optlen != sizeof(uint32_t))
+            return -LSP_ERR_SOCK_OPT_INVALID;
+        return -lsp_queue_set_spin(sock->rx_queue, *(const uint32_t *)optval);
+    default:
+        lsp_verb(tag, "%s: option %d cannot be set\n", __FUNCTION__, opt);
+        return -LSP_ERR_SOCK_OPT_INVALID;
+    }
+}
+
+int lsp_getsockopt(lsp_socket_t sock, int level, int opt, void *optval, size_t optlen)
+{
+    (void)level; // unused
+    if (sock == NULL || optval == NULL)
+        return -LSP_ERR_INVALID;
+
+    switch (opt)
+    {
+    case LSP_SO_BUSY_POLL:
+        if (optlen != sizeof(uint32_t))
+            return -LSP_ERR_SOCK_OPT_INVALID;
+        return -lsp_queue_getspin(sock->rx_queue, optval, NULL);
+    case LSP_SO_BUSY_POLL_STATS:
+        if (optlen != sizeof(lsp_spin_stats_t))
+            return -LSP_ERR_SOCK_OPT_INVALID;
+        return -lsp_queue_getspin(sock->rx_queue, NULL, optval);
+    default:
+        lsp_verb(tag, "%s: unknown option %d\n", __FUNCTION__, opt);
+        return -LSP_ERR_SOCK_OPT_INVALID;
+    }
+}
@@ -0,0 +1,274 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_timer.h"
+#include "lsp_core.h"
+#include "lsp_mutex.h"
+#include "lsp_time.h"
+#include "lsp_log.h"
+
+static const char *tag = "lsp_timer";
+
+#if (LSP_DEFAULT_TIMER_WHEEL_BITS > 6)
+#error "LSP_DEFAULT_TIMER_WHEEL_BITS: slot bitmap holds at most 64 slots"
+#endif
+#if (LSP_DEFAULT_TIMER_WHEEL_BITS * LSP_DEFAULT_TIMER_WHEEL_LEVELS > 30)
+#error "LSP_DEFAULT_TIMER_WHEEL_LEVELS: wheel span must fit in half the ms clock"
+#endif
+
+#define WHEEL_SLOTS (1 << LSP_DEFAULT_TIMER_WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_SHIFT(level) ((level) * LSP_DEFAULT_TIMER_WHEEL_BITS)
+/** longest delay the wheel can file, longer timers are filed again when their slot cascades */
+#define WHEEL_SPAN ((uint32_t)1 << WHEEL_SHIFT(LSP_DEFAULT_TIMER_WHEEL_LEVELS))
+
+/** 
+ * Timer wheel, level n has WHEEL_SLOTS slots of (1 << WHEEL_SHIFT(n)) ms. 
+ * Slots of level n > 0 are cascaded into the lower levels when level n-1 wraps around
+ */
+static struct
+{
+    lsp_list_head_t slots[LSP_DEFAULT_TIMER_WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t occupied[LSP_DEFAULT_TIMER_WHEEL_LEVELS]; /** slots that may hold timers, cleared lazily */
+    uint32_t time;                                      /** next tick to process */
+    uint32_t deadline;                                  /** time core wakes up if sleeping */
+    uint8_t sleeping;                                   /** core is waiting for deadline */
+    lsp_mutex_t mutex;
+} wheel;
+
+/** internal use only! wheel.mutex must be held */
+static void wheel_add(lsp_timer_t *timer)
+{
+    int level = 0;
+    uint32_t at = timer->expires;
+    uint32_t delta = at - wheel.time;
+
+    if ((int32_t)delta < 0)
+    {
+        // overdue, run on the next tick
+        delta = 0;
+        at = wheel.time;
+    }
+    else if (delta >= WHEEL_SPAN)
+    {
+        delta = WHEEL_SPAN - 1;
+        at = wheel.time + delta;
+    }
+
+    while (delta >= ((uint32_t)1 << WHEEL_SHIFT(level + 1)))
+        level++;
+
+    at = (at >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+    lsp_list_add_tail(&timer->entry, &wheel.slots[level][at]);
+    wheel.occupied[level] |= (uint64_t)1 << at;
+    timer->pending = 1;
+}
+
+/** internal use only! wheel.mutex must be held, returns the distance of the first non empty slot from slot from */
+static int wheel_first(int level, uint32_t from)
+{
+    uint64_t bits, rot;
+    uint32_t slot;
+
+    while ((bits = wheel.occupied[level]) != 0)
+    {
+        rot = from ? (bits >> from) | (bits << (WHEEL_SLOTS - from)) : bits;
+#if (WHEEL_SLOTS < 64)
+        rot &= ((uint64_t)1 << WHEEL_SLOTS) - 1;
+#endif
+
+        slot = (from + __builtin_ctzll(rot)) & WHEEL_MASK;
+        if (!lsp_list_is_empty(&wheel.slots[level][slot]))
+            return __builtin_ctzll(rot);
+        // emptied by cancel
+        wheel.occupied[level] &= ~((uint64_t)1 << slot);
+    }
+    return -1;
+}
+
+/** internal use only! wheel.mutex must be held, returns ms from wheel.time until the next slot is due */
+static uint32_t wheel_next()
+{
+    int d;
+    uint32_t base, due, next = LSP_TIMEOUT_MAX;
+
+    d = wheel_first(0, wheel.time & WHEEL_MASK);
+    if (d >= 0)
+        next = d;
+
+    // upper levels are due when they cascade, timers are re-filed and checked again then
+    for (int level = 1; level < LSP_DEFAULT_TIMER_WHEEL_LEVELS; ++level)
+    {
+        base = (wheel.time + ((uint32_t)1 << WHEEL_SHIFT(level)) - 1) >> WHEEL_SHIFT(level);
+        d = wheel_first(level, base & WHEEL_MASK);
+        if (d < 0)
+            continue;
+        due = ((base + d) << WHEEL_SHIFT(level)) - wheel.time;
+        if (due < next)
+            next = due;
+    }
+    return next;
+}
+
+/** internal use only! wheel.mutex must be held, moves timers of the current slot of level to lower levels */
+static void wheel_cascade(int level)
+{
+    lsp_timer_t *timer;
+    lsp_list_head_t *slot;
+    uint32_t idx = (wheel.time >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+
+    slot = &wheel.slots[level][idx];
+    wheel.occupied[level] &= ~((uint64_t)1 << idx);
+    while (!lsp_list_is_empty(slot))
+    {
+        timer = container_of(slot->next, lsp_timer_t, entry);
+        lsp_list_del(&timer->entry);
+        wheel_add(timer);
+    }
+}
+
+int lsp_timer_wheel_init()
+{
+    for (int level = 0; level < LSP_DEFAULT_TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (int slot = 0; slot < WHEEL_SLOTS; ++slot)
+            lsp_list_head_init(&wheel.slots[level][slot]);
+        wheel.occupied[level] = 0;
+    }
+    wheel.time = lsp_gettime_ms();
+    wheel.deadline = wheel.time;
+    wheel.sleeping = 0;
+
+    return lsp_mutex_init(&wheel.mutex);
+}
+
+int lsp_timer_wheel_free()
+{
+    return lsp_mutex_destroy(&wheel.mutex);
+}
+
+void lsp_timer_init(lsp_timer_t *timer, lsp_timer_func_t func, void *arg)
+{
+    lsp_list_head_init(&timer->entry);
+    timer->expires = 0;
+    timer->func = func;
+    timer->arg = arg;
+    timer->pending = 0;
+}
+
+void lsp_timer_arm(lsp_timer_t *timer, uint32_t delay)
+{
+    int wake = 0;
+
+    lsp_mutex_lock(&wheel.mutex, LSP_TIMEOUT_MAX);
+    if (timer->pending)
+        lsp_list_del(&timer->entry);
+    timer->expires = lsp_gettime_ms() + delay;
+    wheel_add(timer);
+
+    // core sleeps until deadline, wake it up to shorten its sleep
+    if (wheel.sleeping && (int32_t)(timer->expires - wheel.deadline) < 0)
+    {
+        wheel.deadline = timer->expires;
+        wake = 1;
+    }
+    lsp_mutex_unlock(&wheel.mutex);
+
+    if (wake && lsp_core_sendevent(LSP_EV_NO_EVENT, NULL) != LSP_ERR_NONE)
+        lsp_verb(tag, "%s: could not wake core, timer may run late\n", __FUNCTION__);
+}
+
+int lsp_timer_cancel(lsp_timer_t *timer)
+{
+    int pending;
+
+    lsp_mutex_lock(&wheel.mutex, LSP_TIMEOUT_MAX);
+    pending = timer->pending;
+    if (pending)
+    {
+        lsp_list_del(&timer->entry);
+        timer->pending = 0;
+    }
+    lsp_mutex_unlock(&wheel.mutex);
+    return pending;
+}
+
+int lsp_timer_pending(lsp_timer_t *timer)
+{
+    return __atomic_load_n(&timer->pending, __ATOMIC_RELAXED);
+}
+
+uint32_t lsp_timer_run(uint32_t now)
+{
+    lsp_timer_t *timer;
+    lsp_list_head_t expired;
+    lsp_list_head_t *slot;
+    uint32_t idx, next;
+
+    lsp_list_head_init(&expired);
+    lsp_mutex_lock(&wheel.mutex, LSP_TIMEOUT_MAX);
+    wheel.sleeping = 0;
+
+    while ((int32_t)(now - wheel.time) >= 0)
+    {
+        idx = wheel.time & WHEEL_MASK;
+        for (int level = 1; idx == 0 && level < LSP_DEFAULT_TIMER_WHEEL_LEVELS; ++level)
+        {
+            wheel_cascade(level);
+            idx = (wheel.time >> WHEEL_SHIFT(level)) & WHEEL_MASK;
+        }
+        idx = wheel.time & WHEEL_MASK;
+
+        // detach the slot so that callbacks arming for the same tick run on the next one
+        slot = &wheel.slots[0][idx];
+        wheel.occupied[0] &= ~((uint64_t)1 << idx);
+        while (!lsp_list_is_empty(slot))
+            lsp_list_move_tail(slot->next, &expired);
+        wheel.time++;
+
+        while (!lsp_list_is_empty(&expired))
+        {
+            timer = container_of(expired.next, lsp_timer_t, entry);
+            lsp_list_del(&timer->entry);
+            timer->pending = 0;
+
+            lsp_mutex_unlock(&wheel.mutex);
+            timer->func(timer, timer->arg);
+            lsp_mutex_lock(&wheel.mutex, LSP_TIMEOUT_MAX);
+        }
+
+        // nothing on level 0, skip to the next cascade
+        if (wheel.occupied[0] == 0 && (wheel.time & WHEEL_MASK) != 0)
+        {
+            idx = (wheel.time | WHEEL_MASK) + 1;
+            wheel.time = (int32_t)(now - idx) < 0 ? now + 1 : idx;
+        }
+    }
+
+    next = wheel_next();
+    if (next != LSP_TIMEOUT_MAX)
+        next += wheel.time - now;
+    // core never sleeps longer than LSP_DEFAULT_CORE_MAX_SLEEP_MS
+    wheel.deadline = now + (next < LSP_DEFAULT_CORE_MAX_SLEEP_MS ? next : LSP_DEFAULT_CORE_MAX_SLEEP_MS);
+    wheel.sleeping = 1;
+    lsp_mutex_unlock(&wheel.mutex);
+    return next;
+}
@@ -0,0 +1,204 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_interface.h"
+#include "lsp_routing.h"
+#include "lsp_mesh.h"
+#include "lsp_udp.h"
+#include "lsp_time.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+/** Mesh convergence harness. Every node is its own process, since the stack keeps
+ * one node per process, and neighbors are chained into a ring over AF_UNIX datagram links.
+ * Node 0 measures how long its rtable takes to reach every other node and to settle,
+ * then removes its link to node 1 and measures again while routes move to the other side of the ring */
+#define CONV_NODES_DEFAULT 5
+#define CONV_NODES_MAX 16
+#define CONV_ADDR_BASE 0x0010
+#define CONV_TIMEOUT_MS 10000
+#define CONV_QUIET_MS (3 * LSP_DEFAULT_MESH_UPDATE_MS)
+
+static char conv_dir[] = "/tmp/lspconvXXXXXX";
+
+/** path of the socket node a uses for its link to node b */
+static void conv_path(char *path, size_t len, int a, int b)
+{
+    snprintf(path, len, "%s/%d-%d", conv_dir, a, b);
+}
+
+static int conv_link(int node, int peer, lsp_interface_t **iface)
+{
+    char name[16], lpath[64], rpath[64];
+
+    snprintf(name, sizeof(name), "ring%d", peer);
+    conv_path(lpath, sizeof(lpath), node, peer);
+    conv_path(rpath, sizeof(rpath), peer, node);
+    return lsp_udp_create_unix(name, lpath, rpath, iface);
+}
+
+/** starts the node stack and links it to both ring neighbors */
+static int conv_node_start(int node, int nodes, lsp_interface_t **next, lsp_interface_t **prev)
+{
+    int rc;
+    lsp_conf_t conf = *lsp_conf;
+
+    conf.addr = CONV_ADDR_BASE + node;
+    rc = lsp_init(&conf);
+    if (rc != LSP_ERR_NONE)
+        return rc;
+
+    rc = conv_link(node, (node + 1) % nodes, next);
+    if (rc != LSP_ERR_NONE)
+        return rc;
+    return conv_link(node, (node + nodes - 1) % nodes, prev);
+}
+
+static int conv_print_route(lsp_route_t *route, void *arg)
+{
+    (void)arg; // unused
+    printf("  %04X via %04X on %s cost %u\n", route->addr, route->hop.next_hop,
+           route->iface->ifname, route->hop.cost);
+    return 0;
+}
+
+/** number of other nodes node 0 has a route to */
+static int conv_reachable(int nodes)
+{
+    int count = 0;
+
+    for (int i = 1; i < nodes; ++i)
+        if (lsp_route_find(CONV_ADDR_BASE + i) != NULL)
+            count++;
+    return count;
+}
+
+/**
+ * @brief Waits until every node is reachable and the rtable did not change for CONV_QUIET_MS
+ * 
+ * @param phase name of the phase for the report
+ * @param nodes number of nodes in the ring
+ * @param start time in ms the phase started
+ * @return int 0 if converged, -1 on timeout
+ */
+static int conv_measure(const char *phase, int nodes, uint32_t start)
+{
+    lsp_mesh_stats_t ms;
+    uint32_t now, reached = 0;
+
+    for (;;)
+    {
+        now = lsp_gettime_ms();
+        if (now - start > CONV_TIMEOUT_MS)
+        {
+            printf("%s: timeout, %d of %d nodes reachable\n", phase, conv_reachable(nodes), nodes - 1);
+            return -1;
+        }
+
+        if (!reached && conv_reachable(nodes) == nodes - 1)
+            reached = now;
+
+        lsp_mesh_getstats(&ms);
+        if (reached && (int32_t)(now - ms.last_change) >= CONV_QUIET_MS)
+            break;
+        usleep(1000);
+    }
+
+    // last_change is only sampled on mesh ticks, it may trail reached by up to a trigger interval
+    printf("%s: all %d nodes reachable after %u ms, rtable settled after %d ms\n",
+           phase, nodes - 1, reached - start, (int32_t)(ms.last_change - start));
+    lsp_routing_foreach(conv_print_route, NULL);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc = EXIT_FAILURE, nodes = CONV_NODES_DEFAULT, pipefd[2];
+    pid_t pids[CONV_NODES_MAX] = {0};
+    lsp_interface_t *next, *prev;
+    uint32_t start;
+    char c, path[64];
+
+    // usage: converge [nodes]
+    if (argc > 1)
+        nodes = atoi(argv[1]);
+    if (nodes < 3 || nodes > CONV_NODES_MAX)
+    {
+        fprintf(stderr, "nodes must be between 3 and %d\n", CONV_NODES_MAX);
+        return EXIT_FAILURE;
+    }
+
+    if (mkdtemp(conv_dir) == NULL || pipe(pipefd) < 0)
+        return EXIT_FAILURE;
+
+    // children run until node 0 closes the pipe, fork before any thread is started
+    for (int i = 1; i < nodes; ++i)
+    {
+        pids[i] = fork();
+        if (pids[i] < 0)
+            goto end;
+        if (pids[i] == 0)
+        {
+            close(pipefd[1]);
+            if (conv_node_start(i, nodes, &next, &prev) != LSP_ERR_NONE)
+                _exit(EXIT_FAILURE);
+            while (read(pipefd[0], &c, 1) > 0)
+                ;
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    close(pipefd[0]);
+
+    start = lsp_gettime_ms();
+    if (conv_node_start(0, nodes, &next, &prev) != LSP_ERR_NONE)
+        goto end;
+    if (conv_measure("converge", nodes, start) != 0)
+        goto end;
+
+    // routes through node 1 are flushed, they come back through node nodes - 1
+    start = lsp_gettime_ms();
+    if (lsp_interface_unregister(next) != LSP_ERR_NONE)
+        goto end;
+    if (conv_measure("reconverge", nodes, start) != 0)
+        goto end;
+    rc = EXIT_SUCCESS;
+
+end:
+    close(pipefd[1]);
+    for (int i = 1; i < nodes; ++i)
+    {
+        if (pids[i] > 0)
+            waitpid(pids[i], NULL, 0);
+    }
+    for (int a = 0; a < nodes; ++a)
+    {
+        conv_path(path, sizeof(path), a, (a + 1) % nodes);
+        unlink(path);
+        conv_path(path, sizeof(path), (a + 1) % nodes, a);
+        unlink(path);
+    }
+    rmdir(conv_dir);
+    return rc;
+}
@@ -0,0 +1,165 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_evq.h"
+#include "lsp_queue.h"
+#include "lsp_thread.h"
+#include "lsp_time.h"
+
+#include "sched.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+/** Producer contention benchmark of the core event queue. 1 to BENCH_PRODUCERS_MAX producers
+ * push into lsp_evq and, for comparison, into the mutex based lsp_queue it replaced, while one
+ * consumer pops and checks that the events of every producer arrive in order */
+#define BENCH_PRODUCERS_MAX 16
+#define BENCH_EVENTS_DEFAULT 20000
+#define BENCH_POP_TIMEOUT_MS 100
+
+/** entry layout of the lsp_queue, same payload as lsp_evq_entry_t */
+typedef struct bench_event_s
+{
+    uint32_t ev;
+    void *data;
+} bench_event_t;
+
+static lsp_evq_t *bench_evq;
+static lsp_queue_handle_t bench_queue;
+static long bench_events = BENCH_EVENTS_DEFAULT;
+
+/** producer id is the event, data counts up from 1 */
+static lsp_thread_return_t bench_produce_evq(void *arg)
+{
+    uint32_t id = (uintptr_t)arg;
+
+    for (long i = 1; i <= bench_events;)
+    {
+        if (lsp_evq_push(bench_evq, id, (void *)i) == LSP_ERR_NONE)
+            i++;
+        else
+            sched_yield();
+    }
+    return 0;
+}
+
+static lsp_thread_return_t bench_produce_queue(void *arg)
+{
+    bench_event_t event = {.ev = (uintptr_t)arg};
+
+    for (long i = 1; i <= bench_events;)
+    {
+        event.data = (void *)i;
+        if (lsp_queue_push(bench_queue, &event, 0) == LSP_ERR_NONE)
+            i++;
+        else
+            sched_yield();
+    }
+    return 0;
+}
+
+static int bench_pop(int use_queue, lsp_evq_entry_t *entry)
+{
+    int rc;
+    bench_event_t event;
+
+    if (!use_queue)
+        return lsp_evq_pop(bench_evq, entry, BENCH_POP_TIMEOUT_MS);
+
+    rc = lsp_queue_pop(bench_queue, &event, BENCH_POP_TIMEOUT_MS);
+    entry->ev = event.ev;
+    entry->data = event.data;
+    return rc;
+}
+
+/**
+ * @brief Runs producers against one queue until the consumer took every event
+ * 
+ * @param use_queue 1 for lsp_queue, 0 for lsp_evq
+ * @param producers number of producer threads
+ * @return int number of events that arrived out of order, -1 if producers could not be started
+ */
+static int bench_run(int use_queue, int producers)
+{
+    int errors = 0;
+    long seen[BENCH_PRODUCERS_MAX] = {0};
+    long total = producers * bench_events;
+    lsp_thread_handle_t threads[BENCH_PRODUCERS_MAX];
+    lsp_evq_entry_t entry;
+    uint64_t start, elapsed;
+
+    start = lsp_gettime_us();
+    for (int i = 0; i < producers; ++i)
+    {
+        if (lsp_thread_create(use_queue ? bench_produce_queue : bench_produce_evq, "bench",
+                              0, (void *)(uintptr_t)i, 0, &threads[i]) != LSP_ERR_NONE)
+            return -1;
+    }
+
+    for (long n = 0; n < total;)
+    {
+        if (bench_pop(use_queue, &entry) != LSP_ERR_NONE)
+            continue;
+        if ((long)entry.data != seen[entry.ev] + 1)
+            errors++;
+        seen[entry.ev] = (long)entry.data;
+        n++;
+    }
+    elapsed = lsp_gettime_us() - start;
+
+    for (int i = 0; i < producers; ++i)
+        lsp_thread_join(threads[i]);
+
+    printf("%-9s producers %2d: %6.2f Mev/s, %d out of order\n", use_queue ? "lsp_queue" : "lsp_evq",
+           producers, total / (double)elapsed, errors);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int rc, errors = 0;
+
+    // usage: evqbench [events per producer]
+    if (argc > 1)
+        bench_events = atol(argv[1]);
+    if (bench_events <= 0)
+        return EXIT_FAILURE;
+
+    bench_evq = lsp_evq_create(LSP_DEFAULT_CORE_EVQUEUE_LEN);
+    bench_queue = lsp_queue_create(LSP_DEFAULT_CORE_EVQUEUE_LEN, sizeof(bench_event_t));
+    if (bench_evq == NULL || bench_queue == NULL)
+        return EXIT_FAILURE;
+
+    for (int producers = 1; producers <= BENCH_PRODUCERS_MAX; producers *= 2)
+    {
+        for (int use_queue = 0; use_queue <= 1; ++use_queue)
+        {
+            rc = bench_run(use_queue, producers);
+            if (rc < 0)
+                return EXIT_FAILURE;
+            errors += rc;
+        }
+    }
+
+    lsp_evq_destroy(bench_evq);
+    lsp_queue_destroy(bench_queue);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
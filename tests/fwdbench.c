@@ -0,0 +1,190 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_buffer.h"
+#include "lsp_interface.h"
+#include "lsp_core.h"
+#include "lsp_routing.h"
+#include "lsp_veth.h"
+#include "lsp_time.h"
+
+#include "inttypes.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+/** Forwarding throughput check. Packets for FWD_ADDR are sent from fwd0 and received on fwd1,
+ * which relays them through lsp_forward to the sink interface routed to FWD_ADDR.
+ * The sink driver counts forwarded packets and frees them.
+ * Usage: fwdbench [core_workers] [rx_inline] [packets] */
+#define FWD_ADDR 0x1234
+#define FWD_PACKETS_DEFAULT 20000
+#define FWD_PAYLOAD 64
+#define FWD_PORT LSP_SP_MAX
+#define FWD_FLOWS 8
+#define FWD_TIMEOUT_MS 10000
+#define FWD_INFLIGHT (LSP_DEFAULT_CORE_EVQUEUE_LEN / 2)
+
+/** packets of the check that reached the sink */
+static uint64_t fwd_sunk;
+
+static int sink_open(lsp_interface_t *iface)
+{
+    (void)iface;
+    return LSP_ERR_NONE;
+}
+
+static int sink_close(lsp_interface_t *iface)
+{
+    (void)iface;
+    return LSP_ERR_NONE;
+}
+
+static int sink_tx(lsp_interface_t *iface, void *data, size_t len)
+{
+    lsp_packet_t *pkt = data;
+
+    (void)iface;
+    if (len >= sizeof(lsp_packet_t) && pkt->dst_addr == FWD_ADDR)
+        __atomic_add_fetch(&fwd_sunk, 1, __ATOMIC_RELAXED);
+    return LSP_ERR_NONE;
+}
+
+static int sink_tx_burst(lsp_interface_t *iface, lsp_buffer_t **bufs, int n)
+{
+    for (int i = 0; i < n; ++i)
+        sink_tx(iface, bufs[i]->data, lsp_buffer_length(bufs[i]));
+    return n;
+}
+
+static lsp_interface_ops_t sink_ops = {
+    .open = sink_open,
+    .close = sink_close,
+    .tx = sink_tx,
+    .tx_burst = sink_tx_burst};
+
+static int send_packet(lsp_interface_t *iface, int seq)
+{
+    lsp_buffer_t *buff;
+    lsp_packet_t *pkt;
+
+    buff = lsp_buffer_alloc(iface, sizeof(lsp_packet_t) + FWD_PAYLOAD);
+    if (buff == NULL)
+        return LSP_ERR_NOMEM;
+
+    pkt = lsp_buffer_put(buff, sizeof(lsp_packet_t));
+    memset(pkt, 0, sizeof(lsp_packet_t));
+    pkt->dst_addr = FWD_ADDR;
+    pkt->src_addr = lsp_conf->addr;
+    pkt->src_port = FWD_PORT + seq % FWD_FLOWS;
+    pkt->dst_port = FWD_PORT;
+    pkt->seqnum = seq;
+    pkt->plen = FWD_PAYLOAD;
+    memset(lsp_buffer_put(buff, FWD_PAYLOAD), seq, FWD_PAYLOAD);
+
+    return lsp_interface_xmit(iface, buff);
+}
+
+/** packets relayed to the sink or dropped by the forwarding path */
+static uint64_t fwd_done(lsp_interface_t *ingress)
+{
+    lsp_interface_stats_t st;
+
+    lsp_interface_stats_snapshot(ingress, &st);
+    return __atomic_load_n(&fwd_sunk, __ATOMIC_RELAXED) + st.fwd_dropped;
+}
+
+/** lets the core catch up, with LSP_CORE_POLL the test loop is the core */
+static void fwd_idle(useconds_t us)
+{
+#if (LSP_CORE_POLL)
+    if (lsp_core_poll(0) > 0)
+        return;
+#endif
+    usleep(us);
+}
+
+int main(int argc, char **argv)
+{
+    int rc, packets = FWD_PACKETS_DEFAULT;
+    uint32_t start, elapsed;
+    lsp_interface_t *fwd0, *fwd1, *sink;
+    lsp_interface_stats_t ist, sst;
+    lsp_conf_t conf = *lsp_conf;
+
+    if (argc > 1)
+        conf.core_workers = atoi(argv[1]);
+    if (argc > 3)
+        packets = atoi(argv[3]);
+
+    rc = lsp_init(&conf);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+
+    rc = lsp_veth_create("fwd", 256, &fwd0, &fwd1);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+    if (argc > 2)
+        lsp_interface_set_rx_inline(fwd1, atoi(argv[2]));
+
+    sink = lsp_interface_alloc(256, 0, "sink");
+    if (sink == NULL)
+        return EXIT_FAILURE;
+    sink->ops = &sink_ops;
+    rc = lsp_interface_register(sink);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+
+    rc = lsp_route_add(sink, FWD_ADDR, -1);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+
+    start = lsp_gettime_ms();
+    for (int i = 0; i < packets; ++i)
+    {
+        // keep at most FWD_INFLIGHT packets between fwd0 and the sink
+        while (i - (int64_t)fwd_done(fwd1) >= FWD_INFLIGHT)
+        {
+            if (lsp_gettime_ms() - start > FWD_TIMEOUT_MS)
+                break;
+            fwd_idle(100);
+        }
+        send_packet(fwd0, i);
+    }
+
+    while (fwd_done(fwd1) < (uint64_t)packets)
+    {
+        if (lsp_gettime_ms() - start > FWD_TIMEOUT_MS)
+            break;
+        fwd_idle(1000);
+    }
+    elapsed = lsp_gettime_ms() - start;
+
+    lsp_interface_stats_snapshot(fwd1, &ist);
+    lsp_interface_stats_snapshot(sink, &sst);
+    printf("%s: rx %" PRIu64 " fwd_dropped %" PRIu64 ", %s: forwarded %" PRIu64 " tx %" PRIu64 " dropped %" PRIu64 "\n",
+           fwd1->ifname, ist.rx_count, ist.fwd_dropped, sink->ifname, sst.forwarded, sst.tx_count, sst.dropped);
+    printf("%" PRIu64 " of %d packets forwarded in %u ms (%" PRIu64 " pkt/s) with %u core workers\n",
+           fwd_sunk, packets, elapsed, elapsed ? fwd_sunk * 1000 / elapsed : 0, lsp_conf->core_workers);
+
+    return fwd_sunk == (uint64_t)packets ? EXIT_SUCCESS : EXIT_FAILURE;
+}
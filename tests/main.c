@@ -0,0 +1,160 @@
+/* 
+ * Copyright (c) 2021 Cedric Velandres
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * Authors: 
+ *      Cedric Velandres, <ccvelandres@gmail.com>
+ */
+
+
+#include "lsp.h"
+#include "lsp_buffer.h"
+#include "lsp_interface.h"
+#include "lsp_core.h"
+#include "lsp_veth.h"
+#include "lsp_time.h"
+
+#include "inttypes.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+/** packets sent from veth0 to own address, received back on veth1.
+ * Core evqueue holds both tx and rx events, in flight packets are kept below its length.
+ * Packets are spread over TEST_FLOWS source ports so that every core worker gets some */
+#define TEST_PACKETS 1000
+#define TEST_PAYLOAD 64
+#define TEST_PORT LSP_SP_MAX
+#define TEST_FLOWS 8
+#define TEST_TIMEOUT_MS 2000
+#define TEST_INFLIGHT (LSP_DEFAULT_CORE_EVQUEUE_LEN / 2)
+
+static int send_packet(lsp_interface_t *iface, int seq)
+{
+    lsp_buffer_t *buff;
+    lsp_packet_t *pkt;
+
+    buff = lsp_buffer_alloc(iface, sizeof(lsp_packet_t) + TEST_PAYLOAD);
+    if (buff == NULL)
+        return LSP_ERR_NOMEM;
+
+    pkt = lsp_buffer_put(buff, sizeof(lsp_packet_t));
+    memset(pkt, 0, sizeof(lsp_packet_t));
+    pkt->dst_addr = lsp_conf->addr;
+    pkt->src_addr = lsp_conf->addr;
+    pkt->src_port = TEST_PORT + seq % TEST_FLOWS;
+    pkt->dst_port = TEST_PORT;
+    pkt->seqnum = seq;
+    pkt->plen = TEST_PAYLOAD;
+    memset(lsp_buffer_put(buff, TEST_PAYLOAD), seq, TEST_PAYLOAD);
+
+    return lsp_interface_xmit(iface, buff);
+}
+
+static void print_stats(lsp_interface_t *iface)
+{
+    lsp_interface_stats_t st;
+
+    lsp_interface_stats_snapshot(iface, &st);
+    printf("%s: tx %" PRIu64 " (%" PRIu64 " bytes, %" PRIu64 " errors) rx %" PRIu64 " (%" PRIu64 " bytes, %" PRIu64 " errors) dropped %" PRIu64 "\n",
+           iface->ifname, st.tx_count, st.tx_bytes, st.tx_error, st.rx_count, st.rx_bytes, st.rx_error, st.dropped);
+}
+
+/** wakeup latency histogram, bin i counts [2^i, 2^(i+1)) us */
+static void print_hist(const char *name, uint64_t waits, const uint64_t *hist)
+{
+    printf("  %s %" PRIu64 " wakeups, latency us:", name, waits);
+    for (int i = 0; i < LSP_SPIN_HIST_BINS; ++i)
+        if (hist[i])
+            printf(" <%u:%" PRIu64, 2u << i, hist[i]);
+    printf("\n");
+}
+
+/** lets the core catch up, with LSP_CORE_POLL the test loop is the core */
+static void test_idle(useconds_t us)
+{
+#if (LSP_CORE_POLL)
+    if (lsp_core_poll(0) > 0)
+        return;
+#endif
+    usleep(us);
+}
+
+/** packets that reached veth1, either accepted or dropped */
+static uint64_t rx_done(lsp_interface_t *iface, lsp_interface_stats_t *st)
+{
+    lsp_interface_stats_snapshot(iface, st);
+    return st->rx_count + st->dropped;
+}
+
+int main(int argc, char **argv)
+{
+    int rc;
+    uint32_t start, elapsed;
+    lsp_interface_t *veth0, *veth1;
+    lsp_interface_stats_t st;
+    lsp_core_stats_t cst;
+
+    lsp_conf_t conf = *lsp_conf;
+
+    // usage: repo [core_workers] [rx_inline] [core_spin_us]
+    if (argc > 1)
+        conf.core_workers = atoi(argv[1]);
+    if (argc > 3)
+        conf.core_spin_us = atoi(argv[3]);
+
+    rc = lsp_init(&conf);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+
+    rc = lsp_veth_create("veth", 256, &veth0, &veth1);
+    if (rc != LSP_ERR_NONE)
+        return EXIT_FAILURE;
+
+    if (argc > 2)
+        lsp_interface_set_rx_inline(veth1, atoi(argv[2]));
+
+    start = lsp_gettime_ms();
+    for (int i = 0; i < TEST_PACKETS; ++i)
+    {
+        // keep at most TEST_INFLIGHT packets between veth0 and veth1
+        while (i - (int)rx_done(veth1, &st) >= TEST_INFLIGHT)
+            test_idle(100);
+        send_packet(veth0, i);
+    }
+
+    while (rx_done(veth1, &st) < TEST_PACKETS)
+    {
+        if (lsp_gettime_ms() - start > TEST_TIMEOUT_MS)
+            break;
+        test_idle(1000);
+    }
+    elapsed = lsp_gettime_ms() - start;
+
+    print_stats(veth0);
+    print_stats(veth1);
+    for (uint8_t w = 0; lsp_core_getstats(w, &cst) == LSP_ERR_NONE; ++w)
+    {
+        printf("lsp_core%u: %" PRIu64 " events in %" PRIu64 " batches (max %u), budget exhausted %" PRIu64 "\n",
+               w, cst.events, cst.batches, cst.batch_max, cst.budget_exhausted);
+        print_hist("spin", cst.spin.spin_hits, cst.spin.spin_hist);
+        print_hist("block", cst.spin.blocks, cst.spin.block_hist);
+    }
+    printf("%d packets in %u ms with %u core workers\n", TEST_PACKETS, elapsed, lsp_conf->core_workers);
+
+    // mesh advertisements also cross the pair, rx_count may exceed TEST_PACKETS
+    lsp_interface_stats_snapshot(veth1, &st);
+    return (st.dropped == 0 && st.rx_count >= TEST_PACKETS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}